@@ -17,20 +17,27 @@
 #include <errno.h>
 #include <ctype.h>
 #include <fcntl.h>
-#ifndef unix
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef unix
+#include <unistd.h>
+#include <sys/mman.h>
+#else
 #include <io.h>
 #endif
+#include <pthread.h>
+#include <time.h>
+#ifdef unix
+#include <sys/resource.h>
+#endif
 #include "fontstruc.h"
+#include "codepage.h"
+#include "cache.h"
+#include "bdf2fon.h"
+#include "serve.h"
 
-#undef VGA_RESOLUTION
-
-/* Define windows font versions */
-#define WINDOWS_2       0x200
-#define WINDOWS_3_0     0x300
-#define WINDOWS_3_1     0x30a
-
-static int verbose = 1 ;
-static char *program ;
+/* set once in main() before any worker starts, read-only afterwards */
+static const char *program ;
 
 static void usage(void)
 {
@@ -41,11 +48,38 @@ static void usage(void)
     "Modified for variable-width fonts\n"
     "Copyright (C) 2009 grischka@users.sf.net\n"
     "\n"
-    "Usage: bdf2fnt [-q] [-c] [infile [outfile [fontname]]]\n"
+    "Usage: bdf2fnt [-q] [-c] [-p cp,...] [-x n,...] [infile [outfile [fontname]]]\n"
+    "       bdf2fnt [-q] [-c] [-p cp,...] [-x n,...] [-j jobs] -b [infile outfile]...\n"
+    "       bdf2fnt [-q] [-c] [-p cp,...] [-x n,...] [-j jobs] [-n fontname]\n"
+    "               -f fonfile infile...\n"
+    "       bdf2fnt [-j jobs] -S socket\n"
+    "       (all but -S also take --chars list, -C cachedir and --stats)\n"
+    "       Gzip-compressed infiles (.bdf.gz) are read as they are.\n"
     "\n"
     "Options:\n"
-    " -q\t\tQuiet; do not print progress (not currently used)\n"
+    " -q\t\tQuiet; do not print progress on stderr\n"
     " -c\t\tForce OEM (console) character set\n"
+    " -2, -3.0\tWrite a Windows 2.x FNT (the default; up to 64K) or a\n"
+    "\t\t3.x FNT with 32-bit glyph offsets; -3.1 is the same as -3.0\n"
+    " -p cp,...\tRead a Unicode BDF once and write one FNT per code\n"
+    "\t\tpage (437 850 866 1250 1251 1252 1253 1254 1257),\n"
+    "\t\tnamed outfile with _cp before the extension\n"
+    " -x n,...\tWrite the font scaled by each factor (1 to 8), for\n"
+    "\t\thigh-DPI displays; named outfile with _nx for n > 1\n"
+    " -b\t\tBatch mode; convert infile/outfile pairs, or read\n"
+    "\t\t\"infile outfile [fontname]\" lines from stdin if none\n"
+    " -j jobs\tNumber of batch workers (default: number of CPUs)\n"
+    " -f fonfile\tConvert all infiles and put them in one FON file,\n"
+    "\t\twith no intermediate FNT files\n"
+    " -n fontname\tFace name to use instead of the BDF family name\n"
+    " --chars list\tOnly read the glyphs whose ENCODING is in list, such\n"
+    "\t\tas 32-126,0xa0-0xff,U+20AC; others are skipped unparsed\n"
+    " -C cachedir\tReuse earlier output for unchanged input and options;\n"
+    "\t\toutput files may be read-only hard links into cachedir\n"
+    " --stats\tPrint per-phase times, I/O and allocation counts on\n"
+    "\t\tstderr as JSON\n"
+    " -S socket\tServe conversion requests on a Unix domain socket\n"
+    "\t\tuntil interrupted (see bdf2fntc and serve.h)\n"
     "\n"
     "Files:\n"
     " infile\t\tName of input BDF file (stdin if none)\n"
@@ -63,41 +97,9 @@ static void usage(void)
   exit(1);
 }
 
-#define MAX_LINE 512
-
-typedef struct {
-  int xvec, yvec ;
-  int bbox[4] ;
-  int size ;
-  unsigned int *bitmap ;
-} FontChar ;
-
-typedef struct {
-  char *name ;
-  char *xlfd[14] ;
-  int bbox[4] ;
-  int ascent ;
-  int descent ;
-  int pixels ;
-  int defaultch ;
-  int firstch ;
-  int lastch ;
-  int nchars ;
-  int thischar ;
-  int bmwidth ;
-  char copyright[60];
-  FontChar *chars[256+1] ;
-} Font ;
-
-int imin (int a, int b)
-{
-  return a < b ? a : b;
-}
-
-int imax (int a, int b)
-{
-  return a > b ? a : b;
-}
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
 static void *xalloc(size_t num, size_t size)
 {
@@ -111,439 +113,611 @@ static void *xalloc(size_t num, size_t size)
   return mem ;
 }
 
-static Font *newfont(void)
-{
-  Font *fnt = (Font *)xalloc(1, sizeof(Font)) ;
-
-  fnt->ascent = -1 ;
-  fnt->descent = -1 ;
-  fnt->defaultch = -1 ;
-  fnt->thischar = -1 ;
-  fnt->lastch = -1 ;
-  fnt->firstch = 256 ;
-  fnt->nchars = 0 ;
+/* ------------------------------------------------------------------------- */
+/* BDF input: the whole file is mapped, or read in one block from a pipe,
+   and parsed from memory */
 
-  return fnt ;
-}
+typedef struct {
+  char *data ;
+  size_t size ;
+  int mapped ;
+} BdfInput ;
 
-int bdfignore(char *line, FILE *in, Font *fnt)
+static int mapbdf(int fd, BdfInput *in)
 {
+  struct stat st ;
+  size_t max ;
+  ssize_t n ;
+
+  memset(in, 0, sizeof(*in)) ;
+
+#ifdef unix
+  if ( fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 ) {
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) ;
+    if ( map != MAP_FAILED ) {
+      in->data = (char *)map ;
+      in->size = st.st_size ;
+      in->mapped = 1 ;
+      return 1 ;
+    }
+  }
+#endif
+
+  max = fstat(fd, &st) == 0 && st.st_size > 0 ? st.st_size + 1 : 1 << 20 ;
+  in->data = (char *)xalloc(max, 1) ;
+  while ( (n = read(fd, in->data + in->size, max - in->size)) > 0 ) {
+    in->size += n ;
+    if ( in->size == max ) {
+      max *= 2 ;
+      if ( (in->data = (char *)realloc(in->data, max)) == NULL ) {
+        fprintf(stderr, "%s: memory exhausted\n", program);
+        exit(1);
+      }
+    }
+  }
+  if ( n < 0 ) {
+    free(in->data) ;
+    in->data = NULL ;
+    return 0 ;
+  }
   return 1 ;
 }
 
-int bdffontbb(char *line, FILE *in, Font *fnt)
+static void unmapbdf(BdfInput *in)
 {
-  return sscanf(line, "%d %d %d %d\n", &(fnt->bbox[0]),
-                &(fnt->bbox[1]), &(fnt->bbox[2]), &(fnt->bbox[3])) == 4 ;
+#ifdef unix
+  if ( in->mapped ) {
+    munmap(in->data, in->size) ;
+    return ;
+  }
+#endif
+  free(in->data) ;
 }
 
-int bdffont(char *line, FILE *in, Font *fnt)
+/* write() all of data, going round again for short writes */
+static int writeall(FILE *out, const unsigned char *data, long size)
 {
-  char name[MAX_LINE] ;
+  long done ;
 
-  if ( sscanf(line, "%s\n", name) != 1 )
+  if ( fflush(out) != 0 )       /* anything stdio still holds goes first */
     return 0 ;
-
-  if ( ! fnt->name ) {
-    fnt->name = (char *)xalloc(strlen(line) + 1, sizeof(char)) ;
-    strcpy(fnt->name, name) ;
-  }
-
-  if ( name[0] == '-' ) {       /* split out parts of XLFD */
-    int index = 0 ;
-    char *start = name ;
-    char *end = start ;
-
-    do {
-      ++start ;
-      do {
-        ++end ;
-      } while ( *end && *end != '-' ) ;
-      fnt->xlfd[index] = (char *)xalloc(end - start + 1, sizeof(char)) ;
-      strncpy(fnt->xlfd[index], start, end - start) ;
-      fnt->xlfd[index][end - start] = '\0' ;
-      start = end ;
-    } while ( *end && ++index < 14 ) ;
+  for ( done = 0 ; done < size ; ) {
+    ssize_t n = write(fileno(out), data + done, size - done) ;
+    if ( n < 0 && errno == EINTR )
+      continue ;
+    if ( n <= 0 )
+      break ;
+    done += n ;
   }
-
-  return 1 ;
+  return done == size ;
 }
 
-int bdfascent(char *line, FILE *in, Font *fnt)
-{
-  return sscanf(line, "%d\n", &(fnt->ascent)) == 1 ;
-}
+/* ------------------------------------------------------------------------- */
 
-int bdfdescent(char *line, FILE *in, Font *fnt)
-{
-  return sscanf(line, "%d\n", &(fnt->descent)) == 1 ;
-}
+#define MAX_CODEPAGES 16
+#define MAX_OUTPUTS (MAX_CODEPAGES * BDF2FON_MAXSCALE)
 
-int bdfdefault(char *line, FILE *in, Font *fnt)
+/* One infile/outfile conversion; each job gets its own font.  With code
+   pages or scale factors the font is read once and written once for each
+   code page and factor.  Jobs for a .fon keep their .fnt images in memory
+   instead of writing them. */
+typedef struct {
+  char *infile ;                /* NULL for stdin */
+  char *outfile ;               /* NULL for stdout */
+  char *name ;
+  int version ;
+  int oem ;                     /* force OEM charset? */
+  int verbose ;                 /* print progress? */
+  int ncodepages ;
+  const Codepage *codepages[MAX_CODEPAGES] ;
+  int nscales ;
+  int scales[BDF2FON_MAXSCALE] ;
+  const unsigned char *chars ;  /* --chars charset, NULL for all glyphs */
+  const char *cachedir ;        /* NULL for no cache */
+  int cachehits, cachemisses ;
+  int wantstats ;               /* fill in stats? */
+  Bdf2fonStats stats ;
+  long bytesread, byteswritten ;
+  int keep ;                    /* keep images rather than write outfile */
+  int nimages ;
+  unsigned char *image[MAX_OUTPUTS] ;
+  long imagesize[MAX_OUTPUTS] ;
+} Job ;
+
+/* Put a finished image where output k of the job goes: kept in memory,
+   or written to outname (stdout if NULL).  Takes over the image. */
+static int emit(unsigned char *image, long size, const char *outname, Job *job, int k)
 {
-  return sscanf(line, "%d\n", &(fnt->defaultch)) == 1 ;
-}
+  FILE *outfile = stdout ;
+  int result ;
 
-int bdfnchars(char *line, FILE *in, Font *fnt)
-{
-  return sscanf(line, "%d\n", &(fnt->nchars)) == 1 ;
+  if ( job->keep ) {
+    job->image[k] = image ;
+    job->imagesize[k] = size ;
+    return 1 ;
+  }
+
+  /* never write through a hard link into the cache */
+  if ( outname && (remove(outname), (outfile = fopen(outname, "wb")) == NULL) ) {
+    fprintf(stderr, "%s: can't open output file %s\n", program, outname);
+    free(image) ;
+    return 0 ;
+  }
+  result = writeall(outfile, image, size) ;
+  if ( outfile != stdout && fclose(outfile) != 0 )
+    result = 0 ;
+  if ( result )
+    job->byteswritten += size ;
+  if ( ! result ) {
+    fprintf(stderr, "%s: problem writing FON font file %s\n", program,
+            outname ? outname : "(stdout)");
+    if ( outname )
+      remove(outname) ;
+  }
+  free(image) ;
+  return result ;
 }
 
-int bdfpixels(char *line, FILE *in, Font *fnt)
+/* "dir/snap.fnt", code page 1252 and scale 2 make "dir/snap_1252_2x.fnt" */
+static char *outputname(const char *outfile, const Codepage *cp, int scale)
 {
-  return sscanf(line, "%d\n", &(fnt->pixels)) == 1 ;
+  const char *base = strrchr(outfile, '/') ;
+  const char *dot = strrchr(base ? base : outfile, '.') ;
+  size_t stem = dot ? (size_t)(dot - outfile) : strlen(outfile) ;
+  char *name = (char *)xalloc(strlen(outfile) + 32, 1) ;
+  char *p = name + sprintf(name, "%.*s", (int)stem, outfile) ;
+
+  if ( cp )
+    p += sprintf(p, "_%d", cp->id) ;
+  if ( scale != 1 )
+    p += sprintf(p, "_%dx", scale) ;
+  strcpy(p, outfile + stem) ;
+  return name ;
 }
 
-int bdfcopyright(char *line, FILE *in, Font *fnt)
+/* The cache key covers the BDF bytes and every option that changes the
+   .fnt; progress output does not */
+static void jobkey(Job *job, BdfInput *input, CacheKey *key)
 {
-  return 1 == sscanf(line, " \"%59[^\"]\"\n", fnt->copyright);
+  cacheinit(key, "bdf2fnt fnt 2") ;    /* 2: real 3.x output */
+  cachehashint(key, job->version) ;
+  cachehashint(key, job->oem) ;
+  cachehashstr(key, job->name) ;
+  if ( job->chars )
+    cachehash(key, job->chars, BDF2FON_CHARSETSIZE) ;
+  cachehash(key, input->data, input->size) ;
 }
 
-int bdfencode(char *line, FILE *in, Font *fnt)
+/* Fetch output k from the cache; returns 1 on a hit */
+static int fromcache(Job *job, const CacheKey *key, const char *outname, int k)
 {
-  int thischar ;
+  unsigned char *image ;
+  long size ;
 
-  if ( sscanf(line, "%d\n", &thischar) != 1 )
+  if ( outname && ! job->keep )
+    return cacheget(job->cachedir, key, outname) ;
+  if ( (image = cacheread(job->cachedir, key, &size)) == NULL )
     return 0 ;
-  if (thischar > 255)
-    return 0;
-  fnt->thischar = thischar ;
-  if ( thischar > fnt->lastch )
-    fnt->lastch = thischar ;
-  if ( thischar < fnt->firstch )
-    fnt->firstch = thischar ;
+  return emit(image, size, outname, job, k) ;
+}
 
-  fnt->chars[thischar] = (FontChar *)xalloc(1, sizeof(FontChar)) ;
+/* Face name, average width and height of a finished image, on stderr */
+static void progress(const unsigned char *image)
+{
+  FONTFILEHEADER head ;
 
-  return 1 ;
+  memcpy(&head, image, sizeof(head)) ;
+  fprintf(stderr, "%s: %d/%d\n", (const char *)image + head.dffi.dfFace,
+          head.dffi.dfAvgWidth, head.dffi.dfPixHeight);
 }
 
-int bdfwidth(char *line, FILE *in, Font *fnt)
+static int convert(Job *job)
 {
-  FontChar *ch ;
-
-  if ( fnt->thischar < 0 || (ch = fnt->chars[fnt->thischar]) == (FontChar *)0 )
+  int infd = 0 ;
+  BdfInput input ;
+  Bdf2fonFont *thisfont = NULL ;
+  long errline ;
+  int result = 0 ;
+  int i, c, k, ncp, nscale, nout, missing, err ;
+  char *outname[MAX_OUTPUTS] ;
+  CacheKey key[MAX_OUTPUTS] ;
+  int done[MAX_OUTPUTS] ;
+  int named = job->ncodepages || job->nscales ;
+
+  if ( job->infile && (infd = open(job->infile, O_RDONLY | O_BINARY)) < 0 ) {
+    fprintf(stderr, "%s: can't open input file %s\n", program, job->infile);
     return 0 ;
+  }
+  if ( ! mapbdf(infd, &input) ) {
+    fprintf(stderr, "%s: can't read input file %s\n", program,
+            job->infile ? job->infile : "(stdin)");
+    if ( job->infile )
+      close(infd) ;
+    return 0 ;
+  }
 
-  return sscanf(line, "%d %d\n", &(ch->xvec), &(ch->yvec)) == 2 ;
-}
+  job->bytesread += input.size ;
+
+  /* One output per code page and scale factor, or just the one; output
+     i is code page i / nscale at factor i % nscale */
+  ncp = job->ncodepages ? job->ncodepages : 1 ;
+  nscale = job->nscales ? job->nscales : 1 ;
+  nout = ncp * nscale ;
+  if ( job->keep )
+    job->nimages = nout ;
+  for ( i = 0 ; i < nout ; i++ ) {
+    outname[i] = job->keep ? NULL : ! named ? job->outfile :
+      outputname(job->outfile,
+                 job->ncodepages ? job->codepages[i / nscale] : NULL,
+                 job->nscales ? job->scales[i % nscale] : 1) ;
+    done[i] = 0 ;
+  }
 
-int bdfcharbb(char *line, FILE *in, Font *fnt)
-{
-  FontChar *ch ;
-  int result ;
+  missing = nout ;
+  if ( job->cachedir ) {
+    jobkey(job, &input, &key[0]) ;
+    for ( i = 0 ; i < nout ; i++ ) {
+      key[i] = key[0] ;
+      if ( job->ncodepages )
+        cachehashint(&key[i], job->codepages[i / nscale]->id) ;
+      if ( job->nscales )
+        cachehashint(&key[i], -job->scales[i % nscale]) ;
+      if ( (done[i] = fromcache(job, &key[i], outname[i], i)) )
+        missing-- ;
+    }
+    job->cachehits += nout - missing ;
+    job->cachemisses += missing ;
+  }
+  result = 1 ;
+  if ( missing == 0 )
+    goto done ;
+
+  err = bdf2fon_parsesubset(input.data, input.size, job->ncodepages ? BDF2FON_UNICODE : 0,
+                            job->chars, job->wantstats ? &job->stats : NULL,
+                            &thisfont, &errline) ;
+  if ( err != BDF2FON_OK ) {
+    if ( err == BDF2FON_EPARSE )
+      fprintf(stderr, "%s: can't parse line %ld of %s\n", program, errline,
+              job->infile ? job->infile : "(stdin)");
+    else
+      fprintf(stderr, "%s: problem reading BDF font file %s: %s\n", program,
+              job->infile ? job->infile : "(stdin)", bdf2fon_strerror(err));
+    result = 0 ;
+    goto done ;
+  }
 
-  if ( fnt->thischar < 0 || (ch = fnt->chars[fnt->thischar]) == (FontChar *)0 )
-    return 0 ;
+  /* Scale once per factor, then encode every code page from that */
+  for ( k = 0 ; k < nscale ; k++ ) {
+    Bdf2fonFont *fnt = thisfont ;
+    int scale = job->nscales ? job->scales[k] : 1 ;
+
+    for ( c = 0 ; c < ncp && done[c * nscale + k] ; c++ )
+      ;
+    if ( c == ncp )
+      continue ;
+    if ( scale != 1 && (err = bdf2fon_scale(thisfont, scale, &fnt)) != BDF2FON_OK ) {
+      fprintf(stderr, "%s: can't scale %s: %s\n", program,
+              job->infile ? job->infile : "(stdin)", bdf2fon_strerror(err));
+      result = 0 ;
+      continue ;
+    }
 
-  result = (sscanf(line, "%d %d %d %d\n", &(ch->bbox[0]), &(ch->bbox[1]),
-                   &(ch->bbox[2]), &(ch->bbox[3])) == 4) ;
+    for ( c = 0 ; c < ncp ; c++ ) {
+      Bdf2fonOptions options = { job->version, job->oem, 0, job->name } ;
+      unsigned char *image = NULL ;
+      size_t size ;
+
+      i = c * nscale + k ;
+      if ( done[i] )
+        continue ;
+      if ( job->ncodepages )
+        options.codepage = job->codepages[c]->id ;
+      if ( (err = bdf2fon_fnt(fnt, &options, &image, &size)) != BDF2FON_OK ) {
+        fprintf(stderr, "%s: can't encode %s: %s\n", program,
+                outname[i] ? outname[i] : job->keep ? job->infile : "(stdout)",
+                bdf2fon_strerror(err));
+        result = 0 ;
+        continue ;
+      }
+      if ( job->verbose )
+        progress(image) ;
+      if ( job->cachedir )
+        cacheput(job->cachedir, &key[i], image, size) ;
+      if ( ! emit(image, size, outname[i], job, i) )
+        result = 0 ;
+    }
 
-  if ( result ) {
-    if ( ch->bbox[0] > fnt->bbox[0] )
-      fnt->bbox[0] = ch->bbox[0] ;
-    if ( ch->bbox[1] > fnt->bbox[1] )
-      fnt->bbox[1] = ch->bbox[1] ;
+    if ( fnt != thisfont )
+      bdf2fon_free(fnt) ;
   }
 
+done:
+  if ( named && ! job->keep )
+    for ( i = 0 ; i < nout ; i++ )
+      free(outname[i]) ;
+  unmapbdf(&input) ;
+  if ( job->infile )
+    close(infd) ;
+  bdf2fon_free(thisfont) ;
   return result ;
 }
 
-int bdfbitmap(char *line, FILE *in, Font *fnt)
+typedef struct {
+  Job *jobs ;
+  int njobs ;
+  int next ;                    /* next job to hand out */
+  int failed ;
+  pthread_mutex_t lock ;
+} Batch ;
+
+static void *worker(void *arg)
 {
-  FontChar *ch ;
-  int bmwidth, bmheight ;
-  unsigned int *row;
-  char buf[MAX_LINE] ;
+  Batch *batch = (Batch *)arg ;
 
-  if ( fnt->thischar < 0 || (ch = fnt->chars[fnt->thischar]) == (FontChar *)0 )
-    return 0 ;
+  for (;;) {
+    int index, ok ;
 
-  //bmwidth = (ch->bbox[0] + imax(0, ch->bbox[2]) + 7) >> 3 ;
-  bmwidth = (ch->xvec + 7) >> 3;
-  bmheight = ch->bbox[1] ;
+    pthread_mutex_lock(&batch->lock) ;
+    index = batch->next < batch->njobs ? batch->next++ : -1 ;
+    pthread_mutex_unlock(&batch->lock) ;
+    if ( index < 0 )
+      break ;
 
-  if ( bmwidth > fnt->bmwidth )
-    fnt->bmwidth = bmwidth ;
+    ok = convert(&batch->jobs[index]) ;
 
-  ch->size = bmheight ;
-  if (!bmheight)
-    return 1;
-  ch->bitmap = row = (unsigned int *)xalloc(ch->size, sizeof(unsigned int)) ;
+    if ( ! ok ) {
+      pthread_mutex_lock(&batch->lock) ;
+      batch->failed++ ;
+      pthread_mutex_unlock(&batch->lock) ;
+    }
+  }
+  return NULL ;
+}
 
-  while ( bmheight-- ) {
-    char *hex = buf ;
-    unsigned int val = 0;
-    int n = 8;
+/* Run all jobs on a pool of nworkers threads; returns number of failures */
+static int runbatch(Job *jobs, int njobs, int nworkers)
+{
+  Batch batch ;
+  pthread_t *threads ;
+  int i, started ;
 
-    if ( ! fgets(buf, MAX_LINE, in) )
-      return 0 ;
+  if ( nworkers <= 0 ) {
+#ifdef _SC_NPROCESSORS_ONLN
+    nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN) ;
+#endif
+    if ( nworkers <= 0 )
+      nworkers = 1 ;
+  }
+  if ( nworkers > njobs )
+    nworkers = njobs ;
+
+  batch.jobs = jobs ;
+  batch.njobs = njobs ;
+  batch.next = 0 ;
+  batch.failed = 0 ;
+  pthread_mutex_init(&batch.lock, NULL) ;
+
+  threads = (pthread_t *)xalloc(nworkers, sizeof(pthread_t)) ;
+  for ( started = 0 ; started < nworkers ; started++ )
+    if ( pthread_create(&threads[started], NULL, worker, &batch) != 0 )
+      break ;
+  if ( started == 0 )           /* no threads available, run inline */
+    worker(&batch) ;
+  for ( i = 0 ; i < started ; i++ )
+    pthread_join(threads[i], NULL) ;
+
+  pthread_mutex_destroy(&batch.lock) ;
+  free(threads) ;
+  return batch.failed ;
+}
 
-    while (n--) {
-      val <<= 4;
-      switch ( *hex ) {
-      case ' ': case '\t' : case '\n' : case '\r' : case '\0':
-        break;
-      case '0': case '1': case '2': case '3': case '4':
-      case '5': case '6': case '7': case '8': case '9':
-        val += *hex++ - '0' ;
-        break ;
-      case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
-        val +=  *hex++ - 'a' + 10 ;
-        break ;
-      case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
-        val +=  *hex++ - 'A' + 10 ;
-        break ;
-      default:
-        return 0 ;
-      }
+/* Put the .fnt images the jobs kept together into one .fon file */
+static int writefon(const char *fonfile, Job *jobs, int njobs, long *fonsize)
+{
+  const unsigned char **fnts ;
+  size_t *sizes, size ;
+  FILE *out ;
+  unsigned char *fon = NULL ;
+  int i, j, n = 0, result ;
+
+  for ( i = 0 ; i < njobs ; i++ )
+    n += jobs[i].nimages ;
+  fnts = (const unsigned char **)xalloc(n, sizeof(*fnts)) ;
+  sizes = (size_t *)xalloc(n, sizeof(*sizes)) ;
+  for ( n = 0, i = 0 ; i < njobs ; i++ )
+    for ( j = 0 ; j < jobs[i].nimages ; j++, n++ ) {
+      fnts[n] = jobs[i].image[j] ;
+      sizes[n] = jobs[i].imagesize[j] ;
     }
-    *row++ = val;
+  result = bdf2fon_fon(fnts, sizes, n, &fon, &size) ;
+  free(fnts) ;
+  free(sizes) ;
+  if ( result != BDF2FON_OK ) {
+    fprintf(stderr, "%s: can't build %s: %s\n", program, fonfile, bdf2fon_strerror(result));
+    return 0 ;
   }
-  return 1 ;
+  if ( (out = fopen(fonfile, "wb")) == NULL ) {
+    fprintf(stderr, "%s: can't open output file %s\n", program, fonfile);
+    bdf2fon_release(fon) ;
+    return 0 ;
+  }
+  result = writeall(out, fon, size) ;
+  if ( fclose(out) != 0 )
+    result = 0 ;
+  *fonsize = result ? size : 0 ;
+  if ( ! result ) {
+    fprintf(stderr, "%s: problem writing FON font file %s\n", program, fonfile);
+    remove(fonfile) ;
+  }
+  bdf2fon_release(fon) ;
+  return result ;
 }
 
-struct {
-  char *name ;
-  int (*function)(char *, FILE *, Font *) ;
-} dispatch[] = {
-  { "STARTFONT", bdfignore },
-  { "FONT", bdffont },
-  { "SIZE", bdfignore },
-  { "FONTBOUNDINGBOX", bdffontbb },
-  { "STARTPROPERTIES", bdfignore },
-  { "FONT_ASCENT", bdfascent },
-  { "FONT_DESCENT", bdfdescent },
-  { "PIXEL_SIZE", bdfpixels },
-  { "DEFAULT_CHAR", bdfdefault },
-  { "COPYRIGHT", bdfcopyright },
-  { "ENDPROPERTIES", bdfignore },
-  { "CHARS", bdfnchars },
-  { "STARTCHAR", bdfignore },
-  { "ENCODING", bdfencode },
-  { "SWIDTH", bdfignore },
-  { "DWIDTH", bdfwidth },
-  { "BBX", bdfcharbb },
-  { "BITMAP", bdfbitmap },
-  { "ENDCHAR", bdfignore },
-  { "ENDFONT", bdfignore },
-  { (char *)0, bdfignore },
-} ;
-
-int readbdf(FILE *in, Font *fnt)
+/* Read "infile outfile [fontname]" lines; blank lines and #comments skipped */
+static Job *readmanifest(FILE *in, Job *proto, int *njobs)
 {
-  static char line[MAX_LINE] ;
-  while ( fgets(line, MAX_LINE, in) ) {
-    int index, len ;
-    char *eow ;
-
-    for ( eow = line; *eow && ! isspace(*eow) ; eow++ ) ;
-    len = eow - line ;
-
-    for ( index = 0 ; dispatch[index].name ; index++ ) {
-      if ( strlen(dispatch[index].name) == len &&
-           strncmp(dispatch[index].name, line, len) == 0 ) {
-        if ( ! (*(dispatch[index].function))(eow, in, fnt) ) {
-          fprintf(stderr, "%s: can't parse line %s\n", program, line);
-          fflush(stderr);
-          exit(1);
-        }
+  char line[4096] ;
+  Job *jobs = NULL ;
+  int n = 0, max = 0 ;
+
+  while ( fgets(line, sizeof(line), in) ) {
+    char *field[3] ;
+    int nfield = 0 ;
+    char *p = line ;
+
+    while ( nfield < 3 ) {
+      while ( isspace((unsigned char)*p) )
+        p++ ;
+      if ( *p == '\0' || *p == '#' )
         break ;
+      field[nfield++] = p ;
+      while ( *p && ! isspace((unsigned char)*p) )
+        p++ ;
+      if ( *p )
+        *p++ = '\0' ;
+    }
+    if ( nfield == 0 )
+      continue ;
+    if ( nfield < 2 ) {
+      fprintf(stderr, "%s: manifest line needs infile and outfile: %s\n",
+              program, field[0]);
+      continue ;
+    }
+
+    if ( n == max ) {
+      max = max ? 2 * max : 64 ;
+      if ( (jobs = (Job *)realloc(jobs, max * sizeof(Job))) == NULL ) {
+        fprintf(stderr, "%s: memory exhausted\n", program);
+        exit(1);
       }
     }
-    
+    jobs[n] = *proto ;
+    jobs[n].infile = strdup(field[0]) ;
+    jobs[n].outfile = strdup(field[1]) ;
+    jobs[n].name = nfield > 2 ? strdup(field[2]) : NULL ;
+    n++ ;
   }
-  return 1 ;
-}
 
-struct writefntopt {
-  int oem ;     /* Force oem charset? */
-} ;
-
-/* ------------------------------------------------------------------------- */
+  *njobs = n ;
+  return jobs ;
+}
 
-int writefnt(FILE *out, Font *fnt, int version, char *name, struct writefntopt *options)
+static double wallclock(void)
 {
-  FONTFILEHEADER *fhead = (FONTFILEHEADER *)xalloc(1, sizeof(FONTFILEHEADER)) ;
-  FONTINFO *finfo = &(fhead->dffi) ;
-  long rastersz = 0 ;
-  long headersz = 0 ;
-  long tablesz = 0 ;
-  char *xlfd ;
-  int maxwidth = 0 ;
-  int avgwidth = 0 ;
-  int totwidth = 0 ;
-  int samewidth = 1 ;
-  int i, f, w, h, rs;
-  FontChar *ch;
-/*
-  unsigned db[] = { 0xC0000000, 0xC0000000, 0xC0000000, 0xC0000000,
-                    0xC0000000, 0xC0000000, 0xC0000000, 0xC0000000 };
-  FontChar dc = { 3, 0, {2, 8, 1, -1}, 8, db };
-*/
-
-  f = 129;
-
-  i = fnt->defaultch + fnt->firstch;
-  if ( i < fnt->firstch || i > fnt->lastch)
-      i = '?';
-  fnt->chars[f] = fnt->chars[i];
-
-  //fnt->chars[f] = &dc;
-
-  fnt->defaultch = f - fnt->firstch;
-  if (f > fnt->lastch)
-      fnt->lastch = f;
-
-  //fnt->lastch = 255;
-
-  fnt->chars[fnt->lastch + 1] = fnt->chars[32];
-  fnt->nchars = fnt->lastch + 1 - fnt->firstch;
-
-  w = fnt->bmwidth;
-  h = fnt->bbox[1];
-  rs = w * h;
-
-  /* Fill in gaps from first to last character, and calculate raster size */
-  for ( i = fnt->firstch ; i <= fnt->lastch ; i++ ) {
-    int width;
-    ch = fnt->chars[i];
-    if ( ch == NULL )
-      fnt->chars[i] = ch = fnt->chars[fnt->firstch + fnt->defaultch] ;
+  struct timespec ts ;
+  clock_gettime(CLOCK_MONOTONIC, &ts) ;
+  return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
 
-    width = ch->xvec ;
-    if (maxwidth && width != maxwidth)
-        samewidth = 0 ;
-    maxwidth = imax(width, maxwidth);
-    totwidth += width ;
+/* JSON string, escaped */
+static void jsonstr(FILE *out, const char *s)
+{
+  putc('"', out) ;
+  for ( ; s && *s ; s++ ) {
+    unsigned char c = *s ;
+    if ( c == '"' || c == '\\' )
+      fprintf(out, "\\%c", c) ;
+    else if ( c < 0x20 )
+      fprintf(out, "\\u%04x", c) ;
+    else
+      putc(c, out) ;
   }
-  avgwidth = totwidth / fnt->nchars ;
+  putc('"', out) ;
+}
 
-  if ( name == NULL && fnt->xlfd[1] && *(fnt->xlfd[1]) ) 
-    name = fnt->xlfd[1] ;
-  if ( name == NULL ) {
-    fprintf(stderr, "no font name\n");
-    return 0;
-  }
+static void jsonphases(FILE *out, const Bdf2fonStats *st)
+{
+  int i ;
 
-  printf("%s: %d/%d\n", name, avgwidth, h);
-
-  headersz = (char *)&(finfo->dfFlags) - (char *)fhead;
-  tablesz = (fnt->nchars + 1) * sizeof(RASTERGLYPHENTRY) ;
-  rastersz = (fnt->nchars + 1) * rs ;
-
-  fhead->dfVersion = version ;
-  fhead->dfSize = headersz + tablesz + rastersz + 
-    strlen(name) + 1 ; /* size of entire file in bytes */
-  strcpy(fhead->dfCopyright, 
-    fnt->copyright[0] 
-    ? fnt->copyright
-    : "Converted by bd2fnt, (C) AJCD 1995 (C) 2009 grischka") ;
-  finfo->dfType = PF_RASTER_TYPE ;
-  finfo->dfPoints = fnt->xlfd[6] ? atoi(fnt->xlfd[6]) : fnt->ascent ;   /* well, it's near enough */
-#ifdef VGA_RESOLUTION
-  finfo->dfVertRes = 96 ; /* Standard VGA */
-  finfo->dfHorizRes = 96 ; /* Standard VGA */
-#else
-  finfo->dfVertRes = fnt->xlfd[8] ? atoi(fnt->xlfd[8]) : fnt->xlfd[9] ? atoi(fnt->xlfd[9]) : 96 ;
-  finfo->dfHorizRes = fnt->xlfd[9] ? atoi(fnt->xlfd[9]) : fnt->xlfd[8] ? atoi(fnt->xlfd[8]) : 96 ;
-#endif
-  finfo->dfAscent = fnt->ascent ;
-  finfo->dfInternalLeading = 1 ;
-  finfo->dfExternalLeading = 0 ;
-  finfo->dfItalic = (xlfd = fnt->xlfd[3]) &&
-    (strcmp(xlfd, "i") == 0 || strcmp(xlfd, "o") == 0) ;
-  finfo->dfUnderline = 0 ;
-  finfo->dfStrikeOut = 0 ;
-  finfo->dfWeight = (xlfd = fnt->xlfd[2]) ?
-    (strcmp(xlfd, "medium") == 0 ? 400 :
-     strcmp(xlfd, "bold") == 0 ? 700 :
-     strcmp(xlfd, "light") == 0 ? 200 : 400) : 400 ;
-  finfo->dfCharSet = !options->oem &&
-    (xlfd = fnt->xlfd[12]) && strcmp(xlfd, "iso8859") == 0 ?
-    DF_CHARSET_ANSI : DF_CHARSET_OEM ;
-  finfo->dfPixWidth = 0;
-  finfo->dfPixHeight = h;
-  finfo->dfPitchAndFamily = samewidth ? FF_MODERN : FF_SWISS | FF_VARIABLE ;
-  finfo->dfAvgWidth = avgwidth ;
-  finfo->dfMaxWidth = maxwidth ;
-  finfo->dfFirstChar = fnt->firstch ;
-  finfo->dfLastChar = fnt->lastch ;
-  finfo->dfDefaultChar = fnt->defaultch ;
-  finfo->dfBreakChar = 0 ; /* relative to firstchar */
-  finfo->dfWidthBytes = fnt->bmwidth * fnt->nchars ; /* gr: ??? */
-  finfo->dfDevice = 0 ;
-  finfo->dfFace = headersz + tablesz + rastersz ; /* offset to face name */
-  finfo->dfBitsPointer = 0 ;
-  finfo->dfBitsOffset = headersz + tablesz ; /* offset to bitmap */
-  finfo->dfReserved = 0xFF;
-
-  /* write font header struct */
-  if ( fwrite((void *)fhead, headersz, 1, out) < 1 )
-    return 0 ;
+  fprintf(out, "{") ;
+  for ( i = 0 ; i < BDF2FON_NPHASES ; i++ )
+    fprintf(out, "%s\"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}", i ? ", " : "",
+            bdf2fon_phasename(i), st->wall[i] * 1e3, st->cpu[i] * 1e3) ;
+  fprintf(out, "}") ;
+}
 
-  /* char width table */
-  {
-    short offset = (short)(headersz + tablesz) ;
-    for ( i = fnt->firstch ; i <= fnt->lastch + 1 ; i++ ) {
-      RASTERGLYPHENTRY glyph ;
-      ch = fnt->chars[i] ;
-      if (ch) {
-        glyph.rgeWidth = ch->xvec;
-        glyph.rgeOffset = offset ;
-        offset += rs;
-      } else {
-        glyph.rgeWidth = 0;
-        glyph.rgeOffset = 0;
-      }
-      if ( fwrite((void *)&glyph, sizeof(RASTERGLYPHENTRY), 1, out) < 1 )
-        return 0 ;
-    }
-  }
+/* --stats report: one object per job, then process totals */
+static void printstats(FILE *out, Job *jobs, int njobs, double start,
+                       const char *fonfile, long fonsize)
+{
+  Bdf2fonStats total ;
+  long bytesread = 0, byteswritten = fonsize ;
+  int i, j ;
+#ifdef unix
+  struct rusage ru ;
+#endif
 
-  /* write bitmap data */
-  for ( i = fnt->firstch ; i <= fnt->lastch + 1 ; i++ ) {
-    char tmp[MAX_LINE];
-    int r, s, c, v_offs, h_offs;
-    unsigned b, *p;
-
-    ch = fnt->chars[i] ;
-    if (ch) {
-        p = ch->bitmap;
-        s = ch->size;
-        v_offs = imax(0, (fnt->bbox[1] + fnt->bbox[3]) - (ch->bbox[1] + ch->bbox[3]));
-        h_offs = imax(0, ch->bbox[2]);
-
-        memset(tmp, 0, rs);
-        for (r = 0; r < s; ++r) {
-          b = *p++ >> h_offs;
-          for (c = 0; c < w; ++c) {
-            tmp[r + v_offs + c*h] = (b >> 8*(3-c)) & 255;
-          }
-        }
-        fwrite(tmp, rs, 1, out);
+  memset(&total, 0, sizeof(total)) ;
+  fprintf(out, "{\"program\": \"bdf2fnt\", \"jobs\": [") ;
+  for ( i = 0 ; i < njobs ; i++ ) {
+    const Bdf2fonStats *st = &jobs[i].stats ;
+    fprintf(out, "%s\n  {\"input\": ", i ? "," : "") ;
+    jsonstr(out, jobs[i].infile ? jobs[i].infile : "(stdin)") ;
+    fprintf(out, ", \"output\": ") ;
+    jsonstr(out, jobs[i].keep ? fonfile : jobs[i].outfile ? jobs[i].outfile : "(stdout)") ;
+    fprintf(out, ", \"bytes_read\": %ld, \"bytes_written\": %ld, \"glyphs\": %d, "
+            "\"outputs\": %d, \"cache_hits\": %d, \"allocations\": %d,\n   \"phases\": ",
+            jobs[i].bytesread, jobs[i].byteswritten, st->glyphs, st->outputs,
+            jobs[i].cachehits, st->allocs) ;
+    jsonphases(out, st) ;
+    fprintf(out, ",\n   \"keywords\": {") ;
+    for ( j = 0 ; j <= BDF2FON_NKEYWORDS ; j++ )
+      fprintf(out, "%s\"%s\": %d", j ? ", " : "",
+              bdf2fon_keywordname(j), st->keywords[j]) ;
+    fprintf(out, "}}") ;
+
+    bytesread += jobs[i].bytesread ;
+    byteswritten += jobs[i].byteswritten ;
+    total.glyphs += st->glyphs ;
+    total.outputs += st->outputs ;
+    total.allocs += st->allocs ;
+    for ( j = 0 ; j < BDF2FON_NPHASES ; j++ ) {
+      total.wall[j] += st->wall[j] ;
+      total.cpu[j] += st->cpu[j] ;
     }
   }
+  fprintf(out, "],\n \"bytes_read\": %ld, \"bytes_written\": %ld, \"glyphs\": %d, "
+          "\"outputs\": %d, \"allocations\": %d,\n \"phases\": ",
+          bytesread, byteswritten, total.glyphs, total.outputs, total.allocs) ;
+  jsonphases(out, &total) ;
+  fprintf(out, ",\n \"wall_ms\": %.3f", (wallclock() - start) * 1e3) ;
+#ifdef unix
+  if ( getrusage(RUSAGE_SELF, &ru) == 0 )
+    fprintf(out, ", \"cpu_ms\": %.3f, \"peak_rss_kb\": %ld",
+            (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e3 +
+            (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-3, (long)ru.ru_maxrss) ;
+#endif
+  fprintf(out, "}\n") ;
+}
 
-  /* write face name */
-  if ( fwrite((void *)name, strlen(name) + 1, 1, out) < 1 )
-    return 0 ;
-
-  (void)free(fhead) ;
+static void cachestats(Job *jobs, int njobs)
+{
+  int i, hits = 0, misses = 0 ;
 
-  return 1 ;
+  if ( njobs == 0 || jobs[0].cachedir == NULL || ! jobs[0].verbose )
+    return ;
+  for ( i = 0 ; i < njobs ; i++ ) {
+    hits += jobs[i].cachehits ;
+    misses += jobs[i].cachemisses ;
+  }
+  fprintf(stderr, "%s: cache: %d hits, %d misses\n", program, hits, misses);
 }
 
-/* ------------------------------------------------------------------------- */
-
 int main(int argc, char *argv[])
 {
-  FILE *infile = stdin;
-  FILE *outfile = stdout;
-  Font *thisfont = newfont() ;
-  char *name = NULL ;
-  int version = WINDOWS_2 ;
-  struct writefntopt woptions = { 0 } ;
+  Job job = { NULL, NULL, NULL, BDF2FON_WINDOWS_2, 0, 1 } ;
+  Job *jobs = NULL ;
+  int njobs = 0 ;
+  int batch = 0 ;
+  int nworkers = 0 ;
+  char *fonfile = NULL ;
+  char *sockpath = NULL ;
+  char **files = (char **)xalloc(argc, sizeof(char *)) ;
+  int nfiles = 0 ;
+  long fonsize = 0 ;
+  double start = wallclock() ;
+  int i ;
+  char *p ;
 
   if (argc <= 1) {
       usage();
@@ -553,23 +727,84 @@ int main(int argc, char *argv[])
   for (program = *argv++ ; --argc ; argv++) {
     if (argv[0][0] == '-') {
       switch (argv[0][1]) {
+      case '-':
+        if ( strcmp(argv[0], "--stats") == 0 )
+          job.wantstats = 1 ;
+        else if ( strcmp(argv[0], "--chars") == 0 && argc > 1 ) {
+          unsigned char *set = (unsigned char *)xalloc(BDF2FON_CHARSETSIZE, 1) ;
+          --argc ;
+          if ( bdf2fon_charset(*++argv, set) != BDF2FON_OK )
+            usage() ;
+          job.chars = set ;
+        } else
+          usage() ;
+        break;
       case 'q': /* quiet */
-        verbose = 0;
+        job.verbose = 0;
         break;
       case 'c': /* OEM (console) charset */
-        woptions.oem = 1 ;
+        job.oem = 1 ;
+        break;
+      case 'p': /* code pages, comma separated */
+        if (!--argc)
+          usage();
+        for ( p = *++argv ; *p ; p += *p == ',' ) {
+          const Codepage *cp = findcodepage((int)strtol(p, &p, 10)) ;
+          if ( cp == NULL || job.ncodepages == MAX_CODEPAGES ||
+               (*p != ',' && *p != '\0') )
+            usage();
+          job.codepages[job.ncodepages++] = cp ;
+        }
+        break;
+      case 'x': /* scale factors, comma separated */
+        if (!--argc)
+          usage();
+        for ( p = *++argv ; *p ; p += *p == ',' ) {
+          int scale = (int)strtol(p, &p, 10) ;
+          if ( scale < 1 || scale > BDF2FON_MAXSCALE || job.nscales == BDF2FON_MAXSCALE ||
+               (*p != ',' && *p != '\0') )
+            usage();
+          job.scales[job.nscales++] = scale ;
+        }
+        break;
+      case 'b': /* batch mode */
+        batch = 1 ;
+        break;
+      case 'f': /* all infiles into one .fon */
+        if (!--argc)
+          usage();
+        fonfile = *++argv ;
+        break;
+      case 'C': /* cache directory */
+        if (!--argc)
+          usage();
+        job.cachedir = *++argv ;
+        break;
+      case 'S': /* serve requests on a socket */
+        if (!--argc)
+          usage();
+        sockpath = *++argv ;
+        break;
+      case 'n': /* face name */
+        if (!--argc)
+          usage();
+        job.name = *++argv ;
+        break;
+      case 'j': /* number of batch workers */
+        if (!--argc || (nworkers = atoi(*++argv)) <= 0)
+          usage();
         break;
       case '2': /* windows 2.0 */
         if ( argv[0][2] == '\0' || strcmp(argv[0], "-2.0") == 0 )
-          version = WINDOWS_2 ;
+          job.version = BDF2FON_WINDOWS_2 ;
         else
           usage() ;
         break;
       case '3': /* windows 3.0 */
         if ( argv[0][2] == '\0' || strcmp(argv[0], "-3.0") == 0 )
-          version = WINDOWS_3_0 ;
+          job.version = BDF2FON_WINDOWS_3_0 ;
         else if ( strcmp(argv[0], "-3.1") == 0 )
-          version = WINDOWS_3_1 ;
+          job.version = BDF2FON_WINDOWS_3_1 ;
         else
           usage() ;
         break;
@@ -582,24 +817,68 @@ int main(int argc, char *argv[])
       default:
         usage();
       }
-    } else if (infile == stdin) {
-      if ((infile = fopen(*argv, "r")) == NULL) {
-        fprintf(stderr, "%s: can't open input file %s\n", program, *argv);
-        fflush(stderr);
-        exit(1);
-      }
-    } else if (outfile == stdout) {
-      if ((outfile = fopen(*argv, "wb")) == NULL) {
-        fprintf(stderr, "%s: can't open output file %s\n", program, *argv);
-        fflush(stderr);
-        exit(1);
+    } else
+      files[nfiles++] = *argv ;
+  }
+
+  if ( sockpath ) {
+    if ( batch || fonfile || nfiles )
+      usage() ;
+    if ( serve(sockpath, nworkers) < 0 ) {
+      fprintf(stderr, "%s: can't serve on %s: %s\n", program, sockpath, strerror(errno)) ;
+      return 1 ;
+    }
+    return 0 ;
+  }
+
+  if ( fonfile ) {
+    if ( batch || nfiles == 0 )
+      usage() ;
+    jobs = (Job *)xalloc(nfiles, sizeof(Job)) ;
+    for ( i = 0 ; i < nfiles ; i++ ) {
+      jobs[i] = job ;
+      jobs[i].infile = files[i] ;
+      jobs[i].keep = 1 ;
+    }
+    i = runbatch(jobs, nfiles, nworkers) == 0 &&
+        writefon(fonfile, jobs, nfiles, &fonsize) ;
+    cachestats(jobs, nfiles) ;
+    if ( job.wantstats )
+      printstats(stderr, jobs, nfiles, start, fonfile, fonsize) ;
+    return i ? 0 : 1 ;
+  }
+
+  if ( batch ) {
+    if ( nfiles == 0 )
+      jobs = readmanifest(stdin, &job, &njobs) ;
+    else if ( nfiles % 2 != 0 )
+      usage() ;
+    else {
+      jobs = (Job *)xalloc(nfiles / 2, sizeof(Job)) ;
+      for ( i = 0 ; i < nfiles ; i += 2 ) {
+        jobs[njobs] = job ;
+        jobs[njobs].infile = files[i] ;
+        jobs[njobs].outfile = files[i + 1] ;
+        njobs++ ;
       }
-    } else if (name == NULL) {
-      name = *argv ;
-    } else usage();
+    }
+    i = njobs > 0 && runbatch(jobs, njobs, nworkers) == 0 ;
+    cachestats(jobs, njobs) ;
+    if ( job.wantstats )
+      printstats(stderr, jobs, njobs, start, NULL, 0) ;
+    return i ? 0 : 1 ;
   }
+
+  if ( nfiles > 3 )
+    usage() ;
+  job.infile = nfiles > 0 ? files[0] : NULL ;
+  job.outfile = nfiles > 1 ? files[1] : NULL ;
+  if ( nfiles > 2 )
+    job.name = files[2] ;
+  if ( (job.ncodepages || job.nscales) && job.outfile == NULL )
+    usage() ;
 #ifndef unix
-  if ( outfile == stdout ) {
+  if ( job.outfile == NULL ) {
     int fd = fileno(stdout) ;
     if ( setmode(fd, O_BINARY) < 0 ) {
       fprintf(stderr, "%s: can't reset stdout to binary mode\n", program);
@@ -608,15 +887,12 @@ int main(int argc, char *argv[])
   }
 #endif
 
-  if ( ! readbdf(infile, thisfont) ) {
-    fprintf(stderr, "%s: problem reading BDF font file\n", program);
+  i = convert(&job) ;
+  cachestats(&job, 1) ;
+  if ( job.wantstats )
+    printstats(stderr, &job, 1, start, NULL, 0) ;
+  if ( ! i )
     exit(1);
-  }
-
-  if ( ! writefnt(outfile, thisfont, version, name, &woptions) ) {
-    fprintf(stderr, "%s: problem writing FON font file\n", program);
-    exit(1);
-  }
 
   fclose(stdin) ;
   fclose(stdout) ;
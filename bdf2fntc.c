@@ -0,0 +1,176 @@
+/*
+ * bdf2fntc.c - send one conversion to a bdf2fnt -S server and write what
+ * comes back, as bdf2fnt would have written it.
+ *
+ * Released under the terms of GNU General Public License
+ * (GPL) version 2 (See: http://www.fsf.org/licenses/gpl.html)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "serve.h"
+
+static const char *program ;
+
+static void usage(void)
+{
+  fprintf(stderr,
+    "bdf2fntc: Convert .bdf to .fnt or .fon with a bdf2fnt -S server\n"
+    "\n"
+    "Usage: bdf2fntc -S socket [options] infile outfile\n"
+    "       bdf2fntc -S socket [options] -f fonfile infile...\n"
+    "\n"
+    "Options, as for bdf2fnt:\n"
+    " -c\t\tForce OEM (console) character set\n"
+    " -2, -3.0, -3.1\tFNT version\n"
+    " -p cp\t\tRead a Unicode BDF and write code page cp\n"
+    " -x n\t\tScale by n (1 to 8)\n"
+    " -n fontname\tFace name to use instead of the BDF family name\n"
+    " --chars list\tOnly the glyphs in list, such as 32-126,U+20AC\n"
+    " -f fonfile\tPut all infiles in one FON file; .fnt infiles are\n"
+    "\t\ttaken as they are\n"
+    );
+  exit(1);
+}
+
+static void fail(const char *what, const char *name)
+{
+  fprintf(stderr, "%s: %s %s: %s\n", program, what, name, strerror(errno)) ;
+  exit(1) ;
+}
+
+static char *readfile(const char *name, size_t *size)
+{
+  FILE *in = fopen(name, "rb") ;
+  char *data = NULL ;
+  size_t max = 0 ;
+
+  if ( in == NULL )
+    fail("can't open input file", name) ;
+  *size = 0 ;
+  do {
+    if ( *size == max && (data = (char *)realloc(data, max = max * 2 + 65536)) == NULL )
+      fail("can't read", name) ;
+    *size += fread(data + *size, 1, max - *size, in) ;
+  } while ( ! feof(in) && ! ferror(in) ) ;
+  if ( ferror(in) )
+    fail("can't read", name) ;
+  fclose(in) ;
+  return data ;
+}
+
+static int sendall(int fd, const void *data, size_t size)
+{
+  size_t done ;
+
+  for ( done = 0 ; done < size ; ) {
+    ssize_t n = send(fd, (const char *)data + done, size - done, MSG_NOSIGNAL) ;
+    if ( n < 0 && errno == EINTR )
+      continue ;
+    if ( n <= 0 )
+      return 0 ;
+    done += n ;
+  }
+  return 1 ;
+}
+
+int main(int argc, char *argv[])
+{
+  struct sockaddr_un addr ;
+  char header[1024], reply[320] ;
+  char **files ;
+  char *sockpath = NULL, *fonfile = NULL, *outfile ;
+  char *data[SERVE_MAXPARTS] ;
+  size_t size[SERVE_MAXPARTS], len, got ;
+  FILE *out ;
+  char *image ;
+  int fd, i, nfiles = 0 ;
+
+  program = argv[0] ;
+  files = (char **)calloc(argc, sizeof(char *)) ;
+  len = 0 ;
+  for ( i = 1 ; i < argc ; i++ ) {
+    const char *a = argv[i] ;
+    if ( strcmp(a, "-S") == 0 || strcmp(a, "-f") == 0 ) {
+      if ( ++i == argc )
+        usage() ;
+      *(a[1] == 'S' ? &sockpath : &fonfile) = argv[i] ;
+    } else if ( strcmp(a, "-p") == 0 || strcmp(a, "-x") == 0 || strcmp(a, "-n") == 0 ||
+                strcmp(a, "--chars") == 0 ) {
+      if ( ++i == argc || strpbrk(argv[i], " \t\r\n") ||
+           len + strlen(a) + strlen(argv[i]) + 32 > sizeof(header) )
+        usage() ;
+      len += sprintf(header + 3 + len, " %s %s", a, argv[i]) ;
+    } else if ( strcmp(a, "-c") == 0 || strcmp(a, "-2") == 0 ||
+                strcmp(a, "-2.0") == 0 || strcmp(a, "-3") == 0 ||
+                strcmp(a, "-3.0") == 0 || strcmp(a, "-3.1") == 0 ) {
+      len += sprintf(header + 3 + len, " %s", a) ;
+    } else if ( *a == '-' )
+      usage() ;
+    else
+      files[nfiles++] = argv[i] ;
+  }
+  if ( sockpath == NULL || strlen(sockpath) >= sizeof(addr.sun_path) ||
+       (fonfile ? nfiles < 1 || nfiles > SERVE_MAXPARTS : nfiles != 2) )
+    usage() ;
+  memcpy(header, fonfile ? "fon" : "fnt", 3) ;
+  outfile = fonfile ? fonfile : files[--nfiles] ;
+  for ( i = 0 ; i < nfiles ; i++ ) {
+    data[i] = readfile(files[i], &size[i]) ;
+    if ( len + 32 > sizeof(header) )
+      usage() ;
+    len += sprintf(header + 3 + len, " %lu", (unsigned long)size[i]) ;
+  }
+  strcpy(header + 3 + len, "\n") ;
+
+  memset(&addr, 0, sizeof(addr)) ;
+  addr.sun_family = AF_UNIX ;
+  strcpy(addr.sun_path, sockpath) ;
+  if ( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+       connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 )
+    fail("can't connect to", sockpath) ;
+  if ( ! sendall(fd, header, strlen(header)) )
+    fail("can't send to", sockpath) ;
+  for ( i = 0 ; i < nfiles ; i++ )
+    if ( ! sendall(fd, data[i], size[i]) )
+      fail("can't send to", sockpath) ;
+
+  /* the status line, read a byte at a time so none of the image goes */
+  for ( len = 0 ; len + 1 < sizeof(reply) ; len++ )
+    if ( read(fd, reply + len, 1) != 1 || reply[len] == '\n' )
+      break ;
+  reply[len] = '\0' ;
+  if ( strncmp(reply, "ok ", 3) != 0 ) {
+    fprintf(stderr, "%s: %s\n", program,
+            strncmp(reply, "error ", 6) == 0 ? reply + 6 : "no reply from server") ;
+    return 1 ;
+  }
+  len = strtoul(reply + 3, NULL, 10) ;
+  if ( (image = (char *)malloc(len + 1)) == NULL )
+    fail("can't take reply from", sockpath) ;
+  for ( got = 0 ; got < len ; ) {
+    ssize_t n = read(fd, image + got, len - got) ;
+    if ( n < 0 && errno == EINTR )
+      continue ;
+    if ( n <= 0 ) {
+      fprintf(stderr, "%s: short reply from %s\n", program, sockpath) ;
+      return 1 ;
+    }
+    got += n ;
+  }
+  close(fd) ;
+
+  if ( (out = fopen(outfile, "wb")) == NULL )
+    fail("can't open output file", outfile) ;
+  if ( fwrite(image, 1, len, out) != len || fclose(out) != 0 ) {
+    remove(outfile) ;
+    fail("problem writing", outfile) ;
+  }
+  return 0 ;
+}
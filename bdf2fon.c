@@ -0,0 +1,1690 @@
+/* ------------------------------------------------------------------------- */
+/* bdf2fon.c
+
+   Parse X11 BDF fonts and encode them as MicroSoft .fnt and .fon images,
+   all in memory; the library behind bdf2fnt and fnt2fon (see bdf2fon.h)
+   Copyright (C) Angus J. C. Duggan, 1995-1999
+
+   Modified for variable-width fonts
+   Copyright (C) 2009 grischka@users.sf.net
+
+   Released under the terms of GNU General Public License
+   (GPL) version 2 (See: http://www.fsf.org/licenses/gpl.html)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+#include <zlib.h>
+#include "fontstruc.h"
+#include "codepage.h"
+#include "fon.h"
+#include "bdf2fon.h"
+
+#undef VGA_RESOLUTION
+
+/* Bump allocator owning all parse-time memory of one font.  Blocks come
+   zeroed from calloc and are only released together. */
+typedef struct ArenaBlock {
+  struct ArenaBlock *next ;
+  size_t size ;
+  size_t used ;
+} ArenaBlock ;
+
+typedef struct {
+  ArenaBlock *head ;
+  size_t blocksize ;            /* size of the next block to allocate */
+  int nalloc ;                  /* number of heap calls made */
+  int failed ;                  /* set once a heap call fails */
+} Arena ;
+
+#define ARENA_ALIGN 8
+
+/* Glyph metrics live in parallel arrays indexed by code point, and all
+   bitmaps share one pool: each is rows[c] rows of stride[c] bytes of
+   packed bits, MSB leftmost, starting at pool + bitoff[c].  Fonts read
+   for code page conversion keep the whole BMP, others just 8 bits. */
+#define NCODES 256
+#define NUNICODES 0x10000
+typedef struct bdf2fon_font {
+  Arena arena ;                 /* owns the Font itself and all it points to */
+  char *name ;
+  char *xlfd[14] ;
+  int fontbb[4] ;
+  int ascent ;
+  int descent ;
+  int pixels ;
+  int defaultch ;
+  int nchars ;
+  int thischar ;
+  int bmwidth ;
+  char copyright[60];
+  int ncodes ;                  /* size of the per-code-point arrays */
+  int scale ;                   /* pixel replication factor, 1 as read */
+  Bdf2fonStats *stats ;         /* where to count work, or NULL */
+  const unsigned char *chars ;  /* while parsing, the code points to
+                                   keep (a charset bitmap), NULL for all */
+  int subset ;                  /* read with a charset: the output keeps
+                                   to the glyphs it has */
+  unsigned char *defined ;      /* nonzero where a glyph was read */
+  int *xvec, *yvec ;            /* DWIDTH */
+  int *bbox[4] ;                /* BBX width, height, x and y offset */
+  int *rows ;
+  int *stride ;
+  unsigned int *bitoff ;
+  unsigned char *pool ;
+  size_t poolsize ;
+  size_t poolused ;
+} Font ;
+
+static int imin (int a, int b)
+{
+  return a < b ? a : b;
+}
+
+static int imax (int a, int b)
+{
+  return a > b ? a : b;
+}
+
+/* Return size zeroed bytes from the arena, adding a block if needed;
+   NULL, with arena->failed set, if out of memory */
+static void *aalloc(Arena *arena, size_t size)
+{
+  ArenaBlock *block = arena->head ;
+  void *mem ;
+
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1) ;
+  if ( block == NULL || block->size - block->used < size ) {
+    size_t blocksize = arena->blocksize ;
+    if ( blocksize < size )
+      blocksize = size ;
+    block = (ArenaBlock *)calloc(1, sizeof(ArenaBlock) + ARENA_ALIGN + blocksize) ;
+    if ( block == NULL ) {
+      arena->failed = 1 ;
+      return NULL ;
+    }
+    block->size = blocksize ;
+    block->next = arena->head ;
+    arena->head = block ;
+    arena->blocksize *= 2 ;
+    arena->nalloc++ ;
+  }
+  mem = (char *)block + ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+        + block->used ;
+  block->used += size ;
+  return mem ;
+}
+
+static void freearena(Arena *arena)
+{
+  ArenaBlock *block = arena->head ;
+
+  while ( block ) {
+    ArenaBlock *next = block->next ;
+    free(block) ;
+    block = next ;
+  }
+  arena->head = NULL ;
+}
+
+/* Start arena with the largest block of old, cleared, and free the rest.
+   A program parsing font after font keeps that block warm instead of
+   giving it back to the heap each time. */
+static void reusearena(Arena *arena, Arena *old)
+{
+  ArenaBlock *block, *keep = NULL ;
+
+  for ( block = old->head ; block ; block = block->next )
+    if ( keep == NULL || block->size > keep->size )
+      keep = block ;
+  for ( block = old->head ; block ; ) {
+    ArenaBlock *next = block->next ;
+    if ( block != keep )
+      free(block) ;
+    block = next ;
+  }
+  if ( keep ) {
+    memset((char *)keep + ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1)),
+           0, keep->used) ;
+    keep->used = 0 ;
+    keep->next = NULL ;
+  }
+  arena->head = keep ;
+  old->head = NULL ;
+}
+
+#define CODEBYTES (1 + 8 * sizeof(int) + sizeof(unsigned int))
+
+static void freefont(Font *fnt)
+{
+  Arena arena = fnt->arena ;    /* fnt lives in its own arena */
+
+  if ( fnt->stats )
+    fnt->stats->allocs += arena.nalloc ;
+  freearena(&arena) ;
+}
+
+/* sizehint is the size of the BDF text; every two hex digits make at most
+   one bitmap byte, so most fonts fit in the first block and pool.  The
+   memory of old, if not NULL, is reused and old is gone.  Returns NULL if
+   out of memory. */
+static Font *newfont(size_t sizehint, int ncodes, Font *old)
+{
+  Arena arena = { NULL, sizeof(Font) + ncodes * CODEBYTES + sizehint + 4096, 0, 0 } ;
+  Font *fnt ;
+  int i ;
+
+  if ( old ) {
+    Arena oldarena = old->arena ;   /* old lives in its own arena */
+    if ( old->stats )
+      old->stats->allocs += oldarena.nalloc ;
+    reusearena(&arena, &oldarena) ;
+  }
+  if ( (fnt = (Font *)aalloc(&arena, sizeof(Font))) == NULL ) {
+    freearena(&arena) ;
+    return NULL ;
+  }
+  fnt->arena = arena ;
+  fnt->ncodes = ncodes ;
+  fnt->defined = (unsigned char *)aalloc(&fnt->arena, ncodes) ;
+  fnt->xvec = (int *)aalloc(&fnt->arena, ncodes * sizeof(int)) ;
+  fnt->yvec = (int *)aalloc(&fnt->arena, ncodes * sizeof(int)) ;
+  for ( i = 0 ; i < 4 ; i++ )
+    fnt->bbox[i] = (int *)aalloc(&fnt->arena, ncodes * sizeof(int)) ;
+  fnt->rows = (int *)aalloc(&fnt->arena, ncodes * sizeof(int)) ;
+  fnt->stride = (int *)aalloc(&fnt->arena, ncodes * sizeof(int)) ;
+  fnt->bitoff = (unsigned int *)aalloc(&fnt->arena, ncodes * sizeof(unsigned int)) ;
+  fnt->poolsize = sizehint / 2 + 64 ;
+  fnt->pool = (unsigned char *)aalloc(&fnt->arena, fnt->poolsize) ;
+  fnt->ascent = -1 ;
+  fnt->descent = -1 ;
+  fnt->defaultch = -1 ;
+  fnt->thischar = -1 ;
+  fnt->nchars = 0 ;
+  fnt->scale = 1 ;
+
+  if ( fnt->arena.failed ) {
+    freefont(fnt) ;
+    return NULL ;
+  }
+  return fnt ;
+}
+
+/* ------------------------------------------------------------------------- */
+/* BDF input: the caller's whole buffer, of which handlers get views, or
+   for gzip data a window that is refilled by inflating the next block.
+   Nothing past end is ever read, so it need not be NUL terminated. */
+
+#define GZBLOCK (256 * 1024)
+
+typedef struct {
+  const char *start ;
+  const char *pos ;             /* start of next line */
+  const char *end ;
+  const char *mark ;            /* line being handled, kept in the window */
+  long lines ;                  /* lines before start */
+  z_stream *z ;                 /* NULL when the whole text is in memory */
+  char *buf ;                   /* the gzip window, cap bytes */
+  size_t cap ;
+  int eof ;                     /* last gzip member inflated */
+  int err ;                     /* why inflating stopped early, or 0 */
+} BdfInput ;
+
+/* Slide [mark, end) to the front of the gzip window and inflate up to
+   its end after it.  The window doubles when what must be kept, a long
+   glyph or property block, leaves less than half a block free.  Returns
+   0 if no more text came. */
+static int refill(BdfInput *in)
+{
+  z_stream *z = in->z ;
+  size_t from = in->mark - in->start, kept = in->end - in->mark ;
+  size_t posoff = in->pos - in->mark ;
+  const char *p ;
+
+  if ( z == NULL || in->eof || in->err )
+    return 0 ;
+  for ( p = in->start ; (p = (const char *)memchr(p, '\n', in->mark - p)) != NULL ; p++ )
+    in->lines++ ;
+  if ( in->cap - kept < GZBLOCK / 2 ) {
+    char *buf = (char *)realloc(in->buf, 2 * in->cap) ;
+    if ( buf == NULL ) {
+      in->err = BDF2FON_ENOMEM ;
+      return 0 ;
+    }
+    in->buf = buf ;
+    in->cap *= 2 ;
+  }
+  memmove(in->buf, in->buf + from, kept) ;
+  in->start = in->mark = in->buf ;
+  in->pos = in->buf + posoff ;
+
+  z->next_out = (Bytef *)in->buf + kept ;
+  z->avail_out = in->cap - kept ;
+  while ( z->avail_out > 0 ) {
+    int ret = inflate(z, Z_NO_FLUSH) ;
+    if ( ret == Z_STREAM_END ) {
+      /* another member may follow, as from cat a.gz b.gz */
+      if ( z->avail_in < 2 || z->next_in[0] != 0x1f || z->next_in[1] != 0x8b ) {
+        in->eof = 1 ;
+        break ;
+      }
+      inflateReset(z) ;
+    } else if ( ret != Z_OK ) {
+      in->err = ret == Z_MEM_ERROR ? BDF2FON_ENOMEM : BDF2FON_EGZIP ;
+      break ;
+    }
+  }
+  in->end = in->buf + (in->cap - z->avail_out) ;
+  return in->end > in->buf + kept ;
+}
+
+/* Return the next line as [*line, *eol); *eol is '\n' or end */
+static int nextline(BdfInput *in, const char **line, const char **eol)
+{
+  const char *nl ;
+
+  while ( (nl = in->pos < in->end ? (const char *)memchr(in->pos, '\n', in->end - in->pos) : NULL) == NULL &&
+          in->z && refill(in) )
+    ;
+  if ( in->pos >= in->end )
+    return 0 ;
+  *line = in->pos ;
+  *eol = nl ? nl : in->end ;
+  in->pos = nl ? nl + 1 : in->end ;
+  return 1 ;
+}
+
+/* Parse n blank separated decimal integers from [p, eol).  Unlike
+   sscanf/strtol this never looks at the locale or past the end of line. */
+static int scanints(const char *p, const char *eol, int *val, int n)
+{
+  int i ;
+
+  for ( i = 0 ; i < n ; i++ ) {
+    unsigned int v = 0 ;
+    int neg = 0 ;
+    const char *digits ;
+
+    while ( p < eol && (*p == ' ' || *p == '\t' || *p == '\r') )
+      p++ ;
+    if ( p < eol && (*p == '-' || *p == '+') )
+      neg = *p++ == '-' ;
+    for ( digits = p ; p < eol && (unsigned)(*p - '0') < 10 ; p++ )
+      v = v * 10 + (*p - '0') ;
+    if ( p == digits )
+      break ;
+    val[i] = neg ? -(int)v : (int)v ;
+  }
+  return i ;
+}
+
+/* Skip the rest of the current glyph, up to and including its ENDCHAR,
+   without looking at its lines.  After ENCODING only unusual lines have
+   an 'N' before ENDCHAR does: hex digits, SWIDTH, DWIDTH, BBX and BITMAP
+   have none, so one memchr() normally lands on it.  In a gzip window the
+   search goes on from the last whole line after each refill. */
+static int skipglyph(BdfInput *in)
+{
+  const char *p = in->pos ;
+
+  for (;;) {
+    while ( (p = (const char *)memchr(p, 'N', in->end - p)) != NULL ) {
+      const char *line = p - 1 ;
+      if ( line >= in->pos && (line == in->start || line[-1] == '\n') &&
+           in->end - line >= 7 && memcmp(line, "ENDCHAR", 7) == 0 ) {
+        const char *nl = (const char *)memchr(p, '\n', in->end - p) ;
+        in->pos = nl ? nl + 1 : in->end ;
+        return 1 ;
+      }
+      p++ ;
+    }
+    if ( in->z == NULL )
+      break ;
+    for ( p = in->end ; p > in->pos && p[-1] != '\n' ; p-- ) ;
+    in->pos = p ;
+    if ( ! refill(in) )
+      break ;
+    p = in->pos ;
+  }
+  in->pos = in->end ;
+  return 0 ;
+}
+
+static int bdfignore(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  return 1 ;
+}
+
+static int bdffontbb(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  return scanints(arg, eol, fnt->fontbb, 4) == 4 ;
+}
+
+static int bdffont(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  const char *name, *end ;
+
+  while ( arg < eol && isspace((unsigned char)*arg) )
+    arg++ ;
+  for ( end = arg ; end < eol && ! isspace((unsigned char)*end) ; end++ ) ;
+  if ( end == arg )
+    return 0 ;
+  name = arg ;
+
+  if ( ! fnt->name ) {
+    if ( (fnt->name = (char *)aalloc(&fnt->arena, end - name + 1)) == NULL )
+      return 0 ;
+    memcpy(fnt->name, name, end - name) ;
+  }
+
+  if ( name[0] == '-' ) {       /* split out parts of XLFD */
+    int index = 0 ;
+    const char *start = name ;
+    const char *stop = start ;
+
+    do {
+      ++start ;
+      do {
+        ++stop ;
+      } while ( stop < end && *stop != '-' ) ;
+      if ( (fnt->xlfd[index] = (char *)aalloc(&fnt->arena, stop - start + 1)) == NULL )
+        return 0 ;
+      memcpy(fnt->xlfd[index], start, stop - start) ;
+      start = stop ;
+    } while ( stop < end && ++index < 14 ) ;
+  }
+
+  return 1 ;
+}
+
+static int bdfascent(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  return scanints(arg, eol, &(fnt->ascent), 1) == 1 ;
+}
+
+static int bdfdescent(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  return scanints(arg, eol, &(fnt->descent), 1) == 1 ;
+}
+
+static int bdfdefault(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  return scanints(arg, eol, &(fnt->defaultch), 1) == 1 ;
+}
+
+static int bdfnchars(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  return scanints(arg, eol, &(fnt->nchars), 1) == 1 ;
+}
+
+static int bdfpixels(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  return scanints(arg, eol, &(fnt->pixels), 1) == 1 ;
+}
+
+static int bdfcopyright(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  int n = 0 ;
+
+  while ( arg < eol && isspace((unsigned char)*arg) )
+    arg++ ;
+  if ( arg == eol || *arg++ != '"' )
+    return 0 ;
+  while ( arg < eol && *arg != '"' && n < (int)sizeof(fnt->copyright) - 1 )
+    fnt->copyright[n++] = *arg++ ;
+  fnt->copyright[n] = '\0' ;
+  return n > 0 ;
+}
+
+static int bdfencode(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  int thischar ;
+
+  if ( scanints(arg, eol, &thischar, 1) != 1 )
+    return 0 ;
+  if ( fnt->chars && (thischar < 0 || thischar >= 8 * BDF2FON_CHARSETSIZE ||
+                      ! (fnt->chars[thischar >> 3] & (1 << (thischar & 7)))) ) {
+    fnt->thischar = -1 ;        /* not asked for: neither decoded nor kept */
+    return skipglyph(in) ;
+  }
+  if ( thischar >= fnt->ncodes && fnt->ncodes == NCODES )
+    return 0;
+  if ( thischar < 0 || thischar >= fnt->ncodes ) {
+    fnt->thischar = -1 ;        /* unencoded, or beyond what we keep */
+    return skipglyph(in) ;
+  }
+  fnt->thischar = thischar ;
+
+  fnt->defined[thischar] = 1 ;
+  fnt->xvec[thischar] = fnt->yvec[thischar] = 0 ;
+  fnt->bbox[0][thischar] = fnt->bbox[1][thischar] = 0 ;
+  fnt->bbox[2][thischar] = fnt->bbox[3][thischar] = 0 ;
+  fnt->rows[thischar] = fnt->stride[thischar] = 0 ;
+
+  return 1 ;
+}
+
+static int bdfwidth(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  int c = fnt->thischar ;
+  int vec[2] ;
+
+  if ( c < 0 || scanints(arg, eol, vec, 2) != 2 )
+    return 0 ;
+  fnt->xvec[c] = vec[0] ;
+  fnt->yvec[c] = vec[1] ;
+  /* buildfnt gives every glyph DWIDTH columns, with or without a BITMAP */
+  if ( ((imax(0, vec[0]) + 7) >> 3) > fnt->bmwidth )
+    fnt->bmwidth = (imax(0, vec[0]) + 7) >> 3 ;
+  return 1 ;
+}
+
+static int bdfcharbb(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  int c = fnt->thischar ;
+  int bbox[4] ;
+
+  if ( c < 0 || scanints(arg, eol, bbox, 4) != 4 )
+    return 0 ;
+
+  fnt->bbox[0][c] = bbox[0] ;
+  fnt->bbox[1][c] = bbox[1] ;
+  fnt->bbox[2][c] = bbox[2] ;
+  fnt->bbox[3][c] = bbox[3] ;
+  if ( bbox[0] > fnt->fontbb[0] )
+    fnt->fontbb[0] = bbox[0] ;
+  if ( bbox[1] > fnt->fontbb[1] )
+    fnt->fontbb[1] = bbox[1] ;
+
+  return 1 ;
+}
+
+/* ------------------------------------------------------------------------- */
+/* BITMAP row decoding.  A row is decoded into ndigits/2 bytes, first digit
+   in the high nibble of the first byte; ndigits must be even.  A blank or
+   end of line ends the row early and leaves the remaining bits clear, any
+   other non-hex character before that is an error (returns 0).  Only bytes
+   below limit may be read. */
+
+static int hexrow_scalar(const char *hex, const char *limit, unsigned char *out, int ndigits)
+{
+  int n ;
+
+  for ( n = 0 ; n < ndigits ; n++ ) {
+    unsigned int val = 0 ;
+
+    switch ( hex < limit ? *hex : '\0' ) {
+    case ' ': case '\t' : case '\n' : case '\r' : case '\0':
+      break;
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+      val = *hex++ - '0' ;
+      break ;
+    case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
+      val = *hex++ - 'a' + 10 ;
+      break ;
+    case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
+      val = *hex++ - 'A' + 10 ;
+      break ;
+    default:
+      return 0 ;
+    }
+    if ( n & 1 )
+      out[n >> 1] |= val ;
+    else
+      out[n >> 1] = val << 4 ;
+  }
+  return 1 ;
+}
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <immintrin.h>
+#define HAVE_SIMD_HEXROW
+
+/* Classify 16 characters at once: returns their nibble values, and bit
+   masks of the valid hex digits and of the row terminators */
+static __m128i hexclass_sse2(__m128i c, unsigned *valid, unsigned *term)
+{
+  __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20)) ;
+  __m128i isdig = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1))) ;
+  __m128i isalf = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1))) ;
+  __m128i isend = _mm_or_si128(
+    _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+                 _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'))),
+    _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\n')),
+                              _mm_cmpeq_epi8(c, _mm_set1_epi8('\r'))),
+                 _mm_cmpeq_epi8(c, _mm_setzero_si128()))) ;
+
+  *valid = _mm_movemask_epi8(_mm_or_si128(isdig, isalf)) ;
+  *term = _mm_movemask_epi8(isend) ;
+  return _mm_or_si128(
+    _mm_and_si128(isdig, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+    _mm_and_si128(isalf, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10)))) ;
+}
+
+/* Pack the nibbles of 16 characters into 8 bytes in the low half */
+static __m128i hexpack_sse2(__m128i nib)
+{
+  __m128i hi = _mm_and_si128(_mm_slli_epi16(nib, 4), _mm_set1_epi16(0x00f0)) ;
+  __m128i lo = _mm_srli_epi16(nib, 8) ;
+  return _mm_packus_epi16(_mm_or_si128(hi, lo), _mm_setzero_si128()) ;
+}
+
+static int hexrow_sse2(const char *hex, const char *limit, unsigned char *out, int ndigits)
+{
+  while ( ndigits > 0 && limit - hex >= 16 ) {
+    int chunk = ndigits < 16 ? ndigits : 16 ;
+    unsigned valid, term ;
+    int n ;
+    unsigned char bytes[16] ;
+    __m128i nib = hexclass_sse2(_mm_loadu_si128((const __m128i *)hex), &valid, &term) ;
+
+    n = __builtin_ctz(term | 0x10000) ;
+    if ( n > chunk )
+      n = chunk ;
+    if ( ~valid & ((1u << n) - 1) )
+      return 0 ;
+    nib = _mm_and_si128(nib, _mm_cmpgt_epi8(_mm_set1_epi8(n),
+      _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15))) ;
+    _mm_storeu_si128((__m128i *)bytes, hexpack_sse2(nib)) ;
+    memcpy(out, bytes, chunk >> 1) ;
+    if ( n < chunk ) {          /* row ended early */
+      memset(out + (chunk >> 1), 0, (ndigits - chunk) >> 1) ;
+      return 1 ;
+    }
+    hex += 16 ;
+    out += 8 ;
+    ndigits -= 16 ;
+  }
+  return ndigits > 0 ? hexrow_scalar(hex, limit, out, ndigits) : 1 ;
+}
+
+__attribute__((target("avx2")))
+static int hexrow_avx2(const char *hex, const char *limit, unsigned char *out, int ndigits)
+{
+  while ( ndigits >= 32 && limit - hex >= 32 ) {
+    __m256i c = _mm256_loadu_si256((const __m256i *)hex) ;
+    __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20)) ;
+    __m256i isdig = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c)) ;
+    __m256i isalf = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower)) ;
+    __m256i isend = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')),
+                      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\t'))),
+      _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n')),
+                                      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\r'))),
+                      _mm256_cmpeq_epi8(c, _mm256_setzero_si256()))) ;
+    unsigned valid = _mm256_movemask_epi8(_mm256_or_si256(isdig, isalf)) ;
+    unsigned term = _mm256_movemask_epi8(isend) ;
+    __m256i nib, hi, lo ;
+
+    if ( term )                 /* row ends in this chunk, finish narrower */
+      break ;
+    if ( ~valid )
+      return 0 ;
+    nib = _mm256_or_si256(
+      _mm256_and_si256(isdig, _mm256_sub_epi8(c, _mm256_set1_epi8('0'))),
+      _mm256_and_si256(isalf, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10)))) ;
+    hi = _mm256_and_si256(_mm256_slli_epi16(nib, 4), _mm256_set1_epi16(0x00f0)) ;
+    lo = _mm256_srli_epi16(nib, 8) ;
+    nib = _mm256_packus_epi16(_mm256_or_si256(hi, lo), _mm256_setzero_si256()) ;
+    nib = _mm256_permute4x64_epi64(nib, 0x08) ;
+    _mm_storeu_si128((__m128i *)out, _mm256_castsi256_si128(nib)) ;
+    hex += 32 ;
+    out += 16 ;
+    ndigits -= 32 ;
+  }
+  return hexrow_sse2(hex, limit, out, ndigits) ;
+}
+#endif
+
+static int (*hexrow)(const char *, const char *, unsigned char *, int) = hexrow_scalar ;
+static pthread_once_t hexrowonce = PTHREAD_ONCE_INIT ;
+
+/* Pick the widest row decoder this CPU supports */
+static void inithexrow(void)
+{
+#ifdef HAVE_SIMD_HEXROW
+  __builtin_cpu_init() ;
+  hexrow = __builtin_cpu_supports("avx2") ? hexrow_avx2 : hexrow_sse2 ;
+#endif
+}
+
+static int bdfbitmap(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  int c = fnt->thischar ;
+  int bmwidth, bmheight, stride ;
+  size_t size ;
+  unsigned char *row;
+
+  if ( c < 0 )
+    return 0 ;
+
+  //bmwidth = (fnt->bbox[0][c] + imax(0, fnt->bbox[2][c]) + 7) >> 3 ;
+  bmwidth = (fnt->xvec[c] + 7) >> 3;
+  bmheight = fnt->bbox[1][c] ;
+
+  if ( bmwidth > fnt->bmwidth )
+    fnt->bmwidth = bmwidth ;
+
+  fnt->rows[c] = bmheight = imax(0, bmheight) ;
+  fnt->stride[c] = stride = (imax(0, fnt->bbox[0][c]) + 7) >> 3 ;
+  size = (size_t)bmheight * stride ;
+
+  /* short rows can make the pool outgrow its estimate; bitmaps are found
+     by offset, so it can simply move */
+  if ( fnt->poolused + size > fnt->poolsize ) {
+    unsigned char *pool ;
+    fnt->poolsize = 2 * fnt->poolsize + size ;
+    if ( (pool = (unsigned char *)aalloc(&fnt->arena, fnt->poolsize)) == NULL )
+      return 0 ;
+    memcpy(pool, fnt->pool, fnt->poolused) ;
+    fnt->pool = pool ;
+  }
+  fnt->bitoff[c] = fnt->poolused ;
+  row = fnt->pool + fnt->poolused ;
+  fnt->poolused += size ;
+
+  while ( bmheight-- ) {
+    const char *hex ;
+
+    if ( ! nextline(in, &hex, &eol) ||
+         ! hexrow(hex, in->end, row, 2 * stride) )
+      return 0 ;
+    row += stride ;
+  }
+  return 1 ;
+}
+
+static int bdfproperties(const char *arg, const char *eol, BdfInput *in, Font *fnt) ;
+
+/* Keyword indices into dispatch[]; keep both in the same order */
+enum {
+  BDF_STARTFONT, BDF_FONT, BDF_SIZE, BDF_FONTBOUNDINGBOX, BDF_STARTPROPERTIES,
+  BDF_FONT_ASCENT, BDF_FONT_DESCENT, BDF_PIXEL_SIZE, BDF_DEFAULT_CHAR,
+  BDF_COPYRIGHT, BDF_ENDPROPERTIES, BDF_CHARS, BDF_STARTCHAR, BDF_ENCODING,
+  BDF_SWIDTH, BDF_DWIDTH, BDF_BBX, BDF_BITMAP, BDF_ENDCHAR, BDF_ENDFONT,
+  BDF_NKEYWORDS
+} ;
+
+static struct {
+  char *name ;
+  int (*function)(const char *, const char *, BdfInput *, Font *) ;
+} dispatch[] = {
+  { "STARTFONT", bdfignore },
+  { "FONT", bdffont },
+  { "SIZE", bdfignore },
+  { "FONTBOUNDINGBOX", bdffontbb },
+  { "STARTPROPERTIES", bdfproperties },
+  { "FONT_ASCENT", bdfascent },
+  { "FONT_DESCENT", bdfdescent },
+  { "PIXEL_SIZE", bdfpixels },
+  { "DEFAULT_CHAR", bdfdefault },
+  { "COPYRIGHT", bdfcopyright },
+  { "ENDPROPERTIES", bdfignore },
+  { "CHARS", bdfnchars },
+  { "STARTCHAR", bdfignore },
+  { "ENCODING", bdfencode },
+  { "SWIDTH", bdfignore },
+  { "DWIDTH", bdfwidth },
+  { "BBX", bdfcharbb },
+  { "BITMAP", bdfbitmap },
+  { "ENDCHAR", bdfignore },
+  { "ENDFONT", bdfignore },
+  { (char *)0, bdfignore },
+} ;
+
+/* Classify the keyword [word, word+len) by its length and a distinguishing
+   character, then confirm with one memcmp; returns -1 for unknown words */
+static int bdfkeyword(const char *word, int len)
+{
+  int index ;
+
+  switch ( len ) {
+  case 3:  index = BDF_BBX ; break ;
+  case 4:  index = word[0] == 'F' ? BDF_FONT : BDF_SIZE ; break ;
+  case 5:  index = BDF_CHARS ; break ;
+  case 6:
+    index = word[0] == 'S' ? BDF_SWIDTH :
+            word[0] == 'D' ? BDF_DWIDTH : BDF_BITMAP ;
+    break ;
+  case 7:  index = word[3] == 'F' ? BDF_ENDFONT : BDF_ENDCHAR ; break ;
+  case 8:  index = BDF_ENCODING ; break ;
+  case 9:
+    index = word[0] == 'C' ? BDF_COPYRIGHT :
+            word[5] == 'F' ? BDF_STARTFONT : BDF_STARTCHAR ;
+    break ;
+  case 10: index = BDF_PIXEL_SIZE ; break ;
+  case 11: index = BDF_FONT_ASCENT ; break ;
+  case 12: index = word[0] == 'F' ? BDF_FONT_DESCENT : BDF_DEFAULT_CHAR ; break ;
+  case 13: index = BDF_ENDPROPERTIES ; break ;
+  case 15: index = word[0] == 'F' ? BDF_FONTBOUNDINGBOX : BDF_STARTPROPERTIES ; break ;
+  default: return -1 ;
+  }
+  return memcmp(word, dispatch[index].name, len) == 0 ? index : -1 ;
+}
+
+/* With a charset, walk the property block through ENDPROPERTIES: lines
+   that can't start a keyword are passed over on their first letter, and
+   the rest are classified as readbdf() would.  Any keyword but a property
+   used here (COPYRIGHT, DEFAULT_CHAR, FONT_ASCENT, FONT_DESCENT,
+   PIXEL_SIZE) is left for readbdf(), so a block without its
+   ENDPROPERTIES reads as it does there.  Other properties are not
+   counted in the stats as unknown keywords.  A whole parse reads the
+   block line by line in readbdf(), as before. */
+static int bdfproperties(const char *arg, const char *eol, BdfInput *in, Font *fnt)
+{
+  const char *line ;
+
+  if ( fnt->chars == NULL )
+    return 1 ;
+  for (;;) {
+    const char *eow ;
+    int index ;
+
+    in->mark = in->pos ;        /* as in readbdf(): keep the line in a refill */
+    if ( ! nextline(in, &line, &eol) )
+      break ;
+
+    if ( *line != 'B' && *line != 'C' && *line != 'D' && *line != 'E' &&
+         *line != 'F' && *line != 'P' && *line != 'S' )
+      continue ;
+    for ( eow = line ; eow < eol && *eow != ' ' && *eow != '\t' && *eow != '\r' ; eow++ ) ;
+    if ( (index = bdfkeyword(line, eow - line)) < 0 )
+      continue ;
+    if ( index == BDF_ENDPROPERTIES ) {
+      if ( fnt->stats )
+        fnt->stats->keywords[index]++ ;
+      return 1 ;
+    }
+    if ( index != BDF_COPYRIGHT && index != BDF_DEFAULT_CHAR &&
+         index != BDF_FONT_ASCENT && index != BDF_FONT_DESCENT &&
+         index != BDF_PIXEL_SIZE ) {
+      in->pos = line ;
+      return 1 ;
+    }
+    if ( fnt->stats )
+      fnt->stats->keywords[index]++ ;
+    if ( ! (*(dispatch[index].function))(eow, eol, in, fnt) )
+      return 0 ;
+  }
+  return 1 ;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Work counts for Bdf2fonStats: wall and CPU time per phase, keywords,
+   glyphs and allocations.  A stats block belongs to whoever passed it
+   in, so threads converting different fonts never share one. */
+
+typedef char keywordcheck[BDF_NKEYWORDS == BDF2FON_NKEYWORDS ? 1 : -1] ;
+
+static const char *phasenames[BDF2FON_NPHASES] = { "parse", "scale", "metrics", "raster", "table" } ;
+
+static double wallclock(void)
+{
+  struct timespec ts ;
+  clock_gettime(CLOCK_MONOTONIC, &ts) ;
+  return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+/* CPU time of the calling thread only */
+static double cpuclock(void)
+{
+  struct timespec ts ;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) ;
+  return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+static void startphase(Bdf2fonStats *st, double mark[2])
+{
+  if ( st ) {
+    mark[0] = wallclock() ;
+    mark[1] = cpuclock() ;
+  }
+}
+
+static void endphase(Bdf2fonStats *st, int phase, double mark[2])
+{
+  if ( st ) {
+    st->wall[phase] += wallclock() - mark[0] ;
+    st->cpu[phase] += cpuclock() - mark[1] ;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Run each line through its handler.  On a bad line returns
+   BDF2FON_EPARSE, or BDF2FON_ENOMEM if that was why, with *bad set to
+   the start of the line. */
+static int readbdf(BdfInput *in, Font *fnt, const char **bad)
+{
+  const char *line, *eol ;
+  Bdf2fonStats *st = fnt->stats ;
+  double mark[2] ;
+
+  pthread_once(&hexrowonce, inithexrow) ;
+  startphase(st, mark) ;
+
+  for (;;) {
+    int index ;
+    const char *eow ;
+
+    in->mark = in->pos ;        /* the line stays put while it is handled */
+    if ( ! nextline(in, &line, &eol) )
+      break ;
+
+    for ( eow = line; eow < eol && *eow != ' ' && *eow != '\t' && *eow != '\r' ; eow++ ) ;
+
+    index = bdfkeyword(line, eow - line) ;
+    if ( st )
+      st->keywords[index < 0 ? BDF_NKEYWORDS : index]++ ;
+    if ( index >= 0 &&
+         ! (*(dispatch[index].function))(eow, eol, in, fnt) ) {
+      endphase(st, BDF2FON_PARSE, mark) ;
+      *bad = in->mark ;         /* line itself may have moved in a refill */
+      return fnt->arena.failed ? BDF2FON_ENOMEM : BDF2FON_EPARSE ;
+    }
+  }
+  endphase(st, BDF2FON_PARSE, mark) ;
+  if ( st )
+    st->glyphs = st->keywords[BDF_STARTCHAR] ;
+  return BDF2FON_OK ;
+}
+
+/* ------------------------------------------------------------------------- */
+/* HiDPI variants: every pixel becomes a k by k block.  Rows are widened
+   a byte at a time, each source byte making k bytes, then repeated k
+   times.  k = 2 and 4 widen 8 and 4 bytes per step with SSE2. */
+
+static unsigned char expandlut[BDF2FON_MAXSCALE + 1][256][BDF2FON_MAXSCALE] ;
+static pthread_once_t expandonce = PTHREAD_ONCE_INIT ;
+
+static void initexpand(void)
+{
+  int k, v, bit ;
+
+  for ( k = 1 ; k <= BDF2FON_MAXSCALE ; k++ )
+    for ( v = 0 ; v < 256 ; v++ )
+      for ( bit = 0 ; bit < 8 * k ; bit++ )
+        if ( v & (0x80 >> (bit / k)) )
+          expandlut[k][v][bit >> 3] |= 0x80 >> (bit & 7) ;
+}
+
+/* Widen n bytes of packed pixels into n * k bytes at dst */
+static void expandrow(unsigned char *dst, const unsigned char *src, int n, int k)
+{
+  int i = 0 ;
+
+#ifdef HAVE_SIMD_HEXROW
+  __m128i zero = _mm_setzero_si128() ;
+  if ( k == 2 ) {
+    /* spread bit j of each 16-bit lane to bit 2j, double it, and swap
+       the lane's bytes so the leftmost pixels come first */
+    for ( ; i + 8 <= n ; i += 8 ) {
+      __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + i)), zero) ;
+      v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi16(v, 4)), _mm_set1_epi16(0x0f0f)) ;
+      v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi16(v, 2)), _mm_set1_epi16(0x3333)) ;
+      v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi16(v, 1)), _mm_set1_epi16(0x5555)) ;
+      v = _mm_or_si128(v, _mm_slli_epi16(v, 1)) ;
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)) ;
+      _mm_storeu_si128((__m128i *)(dst + 2 * i), v) ;
+    }
+  } else if ( k == 4 ) {
+    /* the same in 32-bit lanes, bit j going to bits 4j..4j+3 */
+    for ( ; i + 4 <= n ; i += 4 ) {
+      int word ;
+      __m128i v ;
+      memcpy(&word, src + i, 4) ;
+      v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(word), zero), zero) ;
+      v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 12)), _mm_set1_epi32(0x000f000f)) ;
+      v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 6)), _mm_set1_epi32(0x03030303)) ;
+      v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 3)), _mm_set1_epi32(0x11111111)) ;
+      v = _mm_or_si128(v, _mm_slli_epi32(v, 1)) ;
+      v = _mm_or_si128(v, _mm_slli_epi32(v, 2)) ;
+      v = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16)) ;
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)) ;
+      _mm_storeu_si128((__m128i *)(dst + 4 * i), v) ;
+    }
+  }
+#endif
+  for ( ; i < n ; i++ )
+    memcpy(dst + k * i, expandlut[k][src[i]], k) ;
+}
+
+/* A copy of fnt with every pixel and metric k times as big, in its own
+   arena; the names and XLFD fields still point into fnt.  NULL if out of
+   memory. */
+static Font *scalefont(const Font *fnt, int k)
+{
+  Font *big = newfont(2 * fnt->poolused * k * k, fnt->ncodes, NULL) ;
+  int c, i, r ;
+  double mark[2] ;
+
+  if ( big == NULL )
+    return NULL ;
+  startphase(fnt->stats, mark) ;
+  pthread_once(&expandonce, initexpand) ;
+  big->scale = fnt->scale * k ;
+  big->stats = fnt->stats ;
+  big->name = fnt->name ;
+  memcpy(big->xlfd, fnt->xlfd, sizeof(big->xlfd)) ;
+  memcpy(big->copyright, fnt->copyright, sizeof(big->copyright)) ;
+  for ( i = 0 ; i < 4 ; i++ )
+    big->fontbb[i] = fnt->fontbb[i] * k ;
+  big->ascent = fnt->ascent < 0 ? fnt->ascent : fnt->ascent * k ;
+  big->descent = fnt->descent < 0 ? fnt->descent : fnt->descent * k ;
+  big->pixels = fnt->pixels < 0 ? fnt->pixels : fnt->pixels * k ;
+  big->defaultch = fnt->defaultch ;
+  big->nchars = fnt->nchars ;
+  big->subset = fnt->subset ;
+
+  for ( c = 0 ; c < fnt->ncodes ; c++ ) {
+    const unsigned char *src = fnt->pool + fnt->bitoff[c] ;
+    unsigned char *dst ;
+    int stride = fnt->stride[c] * k ;
+
+    if ( ! fnt->defined[c] )
+      continue ;
+    big->defined[c] = 1 ;
+    big->xvec[c] = fnt->xvec[c] * k ;
+    big->yvec[c] = fnt->yvec[c] * k ;
+    for ( i = 0 ; i < 4 ; i++ )
+      big->bbox[i][c] = fnt->bbox[i][c] * k ;
+    big->rows[c] = fnt->rows[c] * k ;
+    big->stride[c] = stride ;
+    big->bitoff[c] = big->poolused ;
+    dst = big->pool + big->poolused ;
+    for ( r = 0 ; r < fnt->rows[c] ; r++, src += fnt->stride[c] ) {
+      expandrow(dst, src, fnt->stride[c], k) ;
+      for ( i = 1 ; i < k ; i++ )
+        memcpy(dst + i * stride, dst, stride) ;
+      dst += k * stride ;
+    }
+    big->poolused += (size_t)big->rows[c] * stride ;
+    big->bmwidth = imax(big->bmwidth, (big->xvec[c] + 7) >> 3) ;
+  }
+  endphase(fnt->stats, BDF2FON_SCALE, mark) ;
+  return big ;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Raster transpose.  BDF bitmaps are stored row by row, w bytes per row;
+   FNT stores each glyph byte column by byte column, h bytes per column. */
+
+static void transpose_generic(unsigned char *dst, const unsigned char *src, int h, int w)
+{
+  int r, c ;
+
+  for ( c = 0 ; c < w ; c++ )
+    for ( r = 0 ; r < h ; r++ )
+      dst[c * h + r] = src[r * w + c] ;
+}
+
+static void transpose2(unsigned char *dst, const unsigned char *src, int h)
+{
+  int r = 0 ;
+
+#ifdef HAVE_SIMD_HEXROW
+  /* 8 rows per step: even bytes are column 0, odd bytes column 1 */
+  __m128i lo = _mm_set1_epi16(0x00ff) ;
+  for ( ; r + 8 <= h ; r += 8 ) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + 2 * r)) ;
+    _mm_storel_epi64((__m128i *)(dst + r),
+                     _mm_packus_epi16(_mm_and_si128(v, lo), lo)) ;
+    _mm_storel_epi64((__m128i *)(dst + h + r),
+                     _mm_packus_epi16(_mm_srli_epi16(v, 8), lo)) ;
+  }
+#endif
+  for ( ; r < h ; r++ ) {
+    dst[r] = src[2 * r] ;
+    dst[h + r] = src[2 * r + 1] ;
+  }
+}
+
+static void transpose3(unsigned char *dst, const unsigned char *src, int h)
+{
+  int r ;
+
+  for ( r = 0 ; r < h ; r++, src += 3 ) {
+    dst[r] = src[0] ;
+    dst[h + r] = src[1] ;
+    dst[2 * h + r] = src[2] ;
+  }
+}
+
+static void transpose4(unsigned char *dst, const unsigned char *src, int h)
+{
+  int r = 0 ;
+
+#ifdef HAVE_SIMD_HEXROW
+  /* 8 rows per step: split even/odd bytes twice */
+  __m128i lo = _mm_set1_epi16(0x00ff) ;
+  for ( ; r + 8 <= h ; r += 8 ) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(src + 4 * r)) ;
+    __m128i b = _mm_loadu_si128((const __m128i *)(src + 4 * r + 16)) ;
+    __m128i even = _mm_packus_epi16(_mm_and_si128(a, lo), _mm_and_si128(b, lo)) ;
+    __m128i odd = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)) ;
+    _mm_storel_epi64((__m128i *)(dst + r),
+                     _mm_packus_epi16(_mm_and_si128(even, lo), lo)) ;
+    _mm_storel_epi64((__m128i *)(dst + h + r),
+                     _mm_packus_epi16(_mm_and_si128(odd, lo), lo)) ;
+    _mm_storel_epi64((__m128i *)(dst + 2 * h + r),
+                     _mm_packus_epi16(_mm_srli_epi16(even, 8), lo)) ;
+    _mm_storel_epi64((__m128i *)(dst + 3 * h + r),
+                     _mm_packus_epi16(_mm_srli_epi16(odd, 8), lo)) ;
+  }
+#endif
+  for ( ; r < h ; r++ ) {
+    dst[r] = src[4 * r] ;
+    dst[h + r] = src[4 * r + 1] ;
+    dst[2 * h + r] = src[4 * r + 2] ;
+    dst[3 * h + r] = src[4 * r + 3] ;
+  }
+}
+
+static void transpose(unsigned char *dst, const unsigned char *src, int h, int w)
+{
+  switch ( w ) {
+  case 0:  break ;
+  case 1:  memcpy(dst, src, h) ; break ;
+  case 2:  transpose2(dst, src, h) ; break ;
+  case 3:  transpose3(dst, src, h) ; break ;
+  case 4:  transpose4(dst, src, h) ; break ;
+  default: transpose_generic(dst, src, h, w) ; break ;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Raster dedup: identical glyph rasters are written once and share their
+   rgeOffset.  Open addressing on an FNV-1a hash of the raster bytes. */
+
+#define DEDUP_SIZE 1024         /* power of two, well above NCODES + 1 */
+
+typedef struct {
+  unsigned int hash[DEDUP_SIZE] ;
+  long offset[DEDUP_SIZE] ;     /* offset into the raster section, or -1 */
+  long size[DEDUP_SIZE] ;
+} Dedup ;
+
+static unsigned int hashbytes(const unsigned char *p, long n)
+{
+  unsigned int hash = 2166136261u ;
+
+  while ( n-- )
+    hash = (hash ^ *p++) * 16777619u ;
+  return hash ;
+}
+
+/* Return the offset of an earlier raster equal to the n bytes at
+   raster + offset, or record that one and return offset itself */
+static long dedupraster(Dedup *dd, const unsigned char *raster, long offset, long n)
+{
+  unsigned int hash = hashbytes(raster + offset, n) ;
+  unsigned int i = hash & (DEDUP_SIZE - 1) ;
+
+  for ( ; dd->offset[i] >= 0 ; i = (i + 1) & (DEDUP_SIZE - 1) )
+    if ( dd->hash[i] == hash && dd->size[i] == n &&
+         memcmp(raster + dd->offset[i], raster + offset, n) == 0 )
+      return dd->offset[i] ;
+  dd->hash[i] = hash ;
+  dd->offset[i] = offset ;
+  dd->size[i] = n ;
+  return offset ;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Lay out and fill in the complete .fnt image in one buffer: the
+   caller's *size bytes at *image, or a malloc'ed one if *image is NULL.
+   Big enough caller buffers are filled in place, smaller ones get a copy
+   if the image fits after raster sharing. */
+static int buildfnt(const Font *fnt, int version, const char *name, int oem,
+                    const Codepage *codepage, unsigned char **result, size_t *size)
+{
+  FONTFILEHEADER head ;
+  FONTFILEHEADER *fhead = &head ;
+  FONTINFO *finfo = &(fhead->dffi) ;
+  long rastersz = 0 ;
+  long headersz = 0 ;
+  long tablesz = 0 ;
+  char *xlfd ;
+  int maxwidth = 0 ;
+  int minwidth = 0 ;
+  int avgwidth = 0 ;
+  int totwidth = 0 ;
+  int samewidth = 1 ;
+  int widthbytes = 0 ;
+  int firstch, lastch, defaultch, nchars ;
+  int i, f, w, h, rs;
+  int glyph[NCODES] ;           /* code point of each byte's glyph, or -1 */
+  int src[NCODES + 1] ;         /* code point each output slot shows, or -1 */
+  int width[NCODES + 1] = { 0 } ;
+  long slotoff[NCODES + 1] ;     /* raster offset of each slot */
+  long *codeoff ;               /* raster offset of each code point, or -1 */
+  Dedup *dedup ;
+  unsigned char *tmp, *image, *raster;
+  size_t imagesz ;
+  Bdf2fonStats *st = fnt->stats ;
+  double mark[2] ;
+
+  startphase(st, mark) ;
+
+  /* Work out which glyph each slot shows, leaving the font untouched */
+  firstch = NCODES ;
+  lastch = -1 ;
+  for ( i = 0 ; i < NCODES ; i++ ) {
+    int code = codepage ? codepagechar(codepage, i) : i ;
+    glyph[i] = code >= 0 && code < fnt->ncodes && fnt->defined[code] ? code : -1 ;
+    if ( glyph[i] >= 0 ) {
+      firstch = imin(firstch, i) ;
+      lastch = i ;
+    }
+  }
+  if ( lastch < 0 )
+    return BDF2FON_ENOGLYPHS ;
+  f = 129;
+
+  i = fnt->defaultch + firstch;
+  if ( i < firstch || i > lastch)
+      i = '?';
+  /* A subset ends at its last glyph: its default is one of them rather
+     than an extra slot 129 */
+  if ( fnt->subset && f > lastch ) {
+    if ( i < firstch || i > lastch || glyph[i] < 0 )
+      i = firstch ;
+    f = i ;
+  }
+  src[f] = glyph[i] ;
+
+  defaultch = f - firstch;
+  if (f > lastch)
+      lastch = f;
+
+  //lastch = 255;
+
+  src[lastch + 1] = glyph[32] ;
+  nchars = lastch + 1 - firstch;
+
+  w = fnt->bmwidth;
+  h = fnt->fontbb[1];
+  rs = w * h;
+
+  /* Fill in gaps from first to last character */
+  for ( i = firstch ; i <= lastch ; i++ )
+    if ( i != f )
+      src[i] = glyph[i] >= 0 ? glyph[i] : src[f] ;
+
+  /* Gather the widths densely, then reduce them */
+  for ( i = firstch ; i <= lastch ; i++ )
+    width[i] = src[i] >= 0 ? fnt->xvec[src[i]] : 0 ;
+  minwidth = maxwidth = width[firstch] ;
+  for ( i = firstch ; i <= lastch ; i++ ) {
+    maxwidth = imax(width[i], maxwidth);
+    minwidth = imin(width[i], minwidth);
+    totwidth += width[i] ;
+    widthbytes += (imax(0, width[i]) + 7) >> 3 ;
+  }
+  widthbytes = (widthbytes + 1) & ~1 ;
+  samewidth = minwidth == maxwidth ;
+  avgwidth = totwidth / nchars ;
+
+  if ( name == NULL && fnt->xlfd[1] && *(fnt->xlfd[1]) ) 
+    name = fnt->xlfd[1] ;
+  if ( name == NULL )
+    return BDF2FON_ENONAME ;
+
+  endphase(st, BDF2FON_METRICS, mark) ;
+  startphase(st, mark) ;
+
+  /* The image is header, glyph table, rasters and face name.  Allocate it
+     for the worst case of no raster sharing and fill it in place.  A 2.x
+     header stops at dfFlags and its table has 16-bit raster offsets; 3.x
+     has the whole header and 32-bit offsets. */
+  memset(fhead, 0, sizeof(*fhead)) ;
+  if ( version == BDF2FON_WINDOWS_2 ) {
+    headersz = (char *)&(finfo->dfFlags) - (char *)fhead;
+    tablesz = (nchars + 1) * sizeof(RASTERGLYPHENTRY) ;
+  } else {
+    headersz = sizeof(FONTFILEHEADER) ;
+    tablesz = (nchars + 1) * sizeof(RASTERGLYPHENTRY3) ;
+  }
+  imagesz = headersz + tablesz + (size_t)(nchars + 1) * rs + strlen(name) + 1 ;
+  image = *result && *size >= imagesz ? *result : (unsigned char *)malloc(imagesz) ;
+  tmp = (unsigned char *)malloc(rs + 16) ;
+  dedup = (Dedup *)malloc(sizeof(Dedup)) ;
+  codeoff = (long *)malloc(fnt->ncodes * sizeof(long)) ;
+  if ( image == NULL || tmp == NULL || dedup == NULL || codeoff == NULL ) {
+    if ( image != *result )
+      free(image) ;
+    free(tmp) ;
+    free(dedup) ;
+    free(codeoff) ;
+    return BDF2FON_ENOMEM ;
+  }
+  raster = image + headersz + tablesz ;
+
+  /* build bitmap data: each glyph gets ceil(width/8) byte columns.  Shift
+     its rows into a cell that wide, then transpose the cell straight into
+     its place in the raster section; no glyph is wider than bmwidth */
+  memset(dedup->offset, -1, sizeof(dedup->offset)) ;
+  for ( i = firstch ; i <= lastch + 1 ; i++ )
+    if ( src[i] >= 0 )
+      codeoff[src[i]] = -1 ;
+  for ( i = firstch ; i <= lastch + 1 ; i++ ) {
+    int r, s, c, v_offs, q, b, g = src[i], stride, gw, gs;
+    unsigned char *p, *row;
+
+    if (g >= 0 && codeoff[g] >= 0) {
+        slotoff[i] = codeoff[g];        /* gap or alias of a glyph already placed */
+    } else if (g >= 0) {
+        p = fnt->pool + fnt->bitoff[g];
+        s = imin(fnt->rows[g], h);
+        stride = fnt->stride[g];
+        v_offs = imax(0, (fnt->fontbb[1] + fnt->fontbb[3]) - (fnt->bbox[1][g] + fnt->bbox[3][g]));
+        q = imax(0, fnt->bbox[2][g]) >> 3;  /* whole bytes to shift right */
+        b = imax(0, fnt->bbox[2][g]) & 7;   /* then remaining bits */
+        gw = (imax(0, fnt->xvec[g]) + 7) >> 3;
+        gs = gw * h;
+
+        memset(tmp, 0, gs);
+        for (r = 0, row = tmp + v_offs*gw; r < s && r + v_offs < h; ++r, p += stride, row += gw) {
+          /* column c takes source bytes c-q-1 and c-q */
+          for (c = q; c < gw && c - q <= stride; ++c) {
+            unsigned v = c - q < stride ? p[c - q] >> b : 0;
+            if (b && c > q)
+              v |= p[c - q - 1] << (8 - b);
+            row[c] = v & 255;
+          }
+        }
+        transpose(raster + rastersz, tmp, h, gw);
+        codeoff[g] = slotoff[i] = dedupraster(dedup, raster, rastersz, gs);
+        if (slotoff[i] == rastersz)
+          rastersz += gs;
+    }
+  }
+  (void)free(tmp) ;
+  (void)free(dedup) ;
+  (void)free(codeoff) ;
+  endphase(st, BDF2FON_RASTER, mark) ;
+
+  /* 2.x fonts live in one 64K segment, with the face name at its end */
+  if ( version == BDF2FON_WINDOWS_2 && headersz + tablesz + rastersz > 0x10000 ) {
+    if ( image != *result )
+      free(image) ;
+    return BDF2FON_ETOOBIG ;
+  }
+  startphase(st, mark) ;
+
+  /* Windows 3.1 reads the 3.0 format; 0x300 is the only 3.x version */
+  fhead->dfVersion = version == BDF2FON_WINDOWS_2 ? 0x200 : 0x300 ;
+  fhead->dfSize = headersz + tablesz + rastersz + 
+    strlen(name) + 1 ; /* size of entire file in bytes */
+  strcpy(fhead->dfCopyright, 
+    fnt->copyright[0] 
+    ? fnt->copyright
+    : "Converted by bd2fnt, (C) AJCD 1995 (C) 2009 grischka") ;
+  finfo->dfType = PF_RASTER_TYPE ;
+  finfo->dfPoints = fnt->xlfd[6] ? atoi(fnt->xlfd[6]) * fnt->scale : fnt->ascent ;   /* well, it's near enough */
+#ifdef VGA_RESOLUTION
+  finfo->dfVertRes = 96 * fnt->scale ; /* Standard VGA */
+  finfo->dfHorizRes = 96 * fnt->scale ; /* Standard VGA */
+#else
+  finfo->dfVertRes = (fnt->xlfd[8] ? atoi(fnt->xlfd[8]) : fnt->xlfd[9] ? atoi(fnt->xlfd[9]) : 96) * fnt->scale ;
+  finfo->dfHorizRes = (fnt->xlfd[9] ? atoi(fnt->xlfd[9]) : fnt->xlfd[8] ? atoi(fnt->xlfd[8]) : 96) * fnt->scale ;
+#endif
+  finfo->dfAscent = fnt->ascent ;
+  finfo->dfInternalLeading = 1 ;
+  finfo->dfExternalLeading = 0 ;
+  finfo->dfItalic = (xlfd = fnt->xlfd[3]) &&
+    (strcmp(xlfd, "i") == 0 || strcmp(xlfd, "o") == 0) ;
+  finfo->dfUnderline = 0 ;
+  finfo->dfStrikeOut = 0 ;
+  finfo->dfWeight = (xlfd = fnt->xlfd[2]) ?
+    (strcmp(xlfd, "medium") == 0 ? 400 :
+     strcmp(xlfd, "bold") == 0 ? 700 :
+     strcmp(xlfd, "light") == 0 ? 200 : 400) : 400 ;
+  finfo->dfCharSet = codepage ? codepage->charset :
+    !oem &&
+    (xlfd = fnt->xlfd[12]) && strcmp(xlfd, "iso8859") == 0 ?
+    DF_CHARSET_ANSI : DF_CHARSET_OEM ;
+  finfo->dfPixWidth = 0;
+  finfo->dfPixHeight = h;
+  finfo->dfPitchAndFamily = samewidth ? FF_MODERN : FF_SWISS | FF_VARIABLE ;
+  finfo->dfAvgWidth = avgwidth ;
+  finfo->dfMaxWidth = maxwidth ;
+  finfo->dfFirstChar = firstch ;
+  finfo->dfLastChar = lastch ;
+  finfo->dfDefaultChar = defaultch ;
+  finfo->dfBreakChar = 0 ; /* relative to firstchar */
+  finfo->dfWidthBytes = widthbytes ; /* of all glyphs side by side, even */
+  finfo->dfDevice = 0 ;
+  finfo->dfFace = headersz + tablesz + rastersz ; /* offset to face name */
+  finfo->dfBitsPointer = 0 ;
+  finfo->dfBitsOffset = headersz + tablesz ; /* offset to bitmap */
+  finfo->dfReserved = 0xFF;
+  if ( version != BDF2FON_WINDOWS_2 ) {
+    /* dfAspace, dfBspace, dfCspace and dfColorPointer stay 0 */
+    finfo->dfFlags = (samewidth ? FSF_FIXED : FSF_PROPORTIONAL) | FSF_1COLOR ;
+  }
+
+  memcpy(image, fhead, headersz) ;
+
+  /* char width table */
+  for ( i = firstch ; i <= lastch + 1 ; i++ ) {
+    long offset = src[i] >= 0 ? headersz + tablesz + slotoff[i] : 0 ;
+    int width = src[i] >= 0 ? fnt->xvec[src[i]] : 0 ;
+    if ( version == BDF2FON_WINDOWS_2 ) {
+      RASTERGLYPHENTRY entry ;
+      entry.rgeWidth = width ;
+      entry.rgeOffset = (short)offset ;   /* below 0x10000, checked above */
+      memcpy(image + headersz + (i - firstch) * sizeof(entry), &entry, sizeof(entry)) ;
+    } else {
+      RASTERGLYPHENTRY3 entry ;
+      entry.rgeWidth = width ;
+      entry.rgeOffset = offset ;
+      memcpy(image + headersz + (i - firstch) * sizeof(entry), &entry, sizeof(entry)) ;
+    }
+  }
+
+  /* face name */
+  memcpy(raster + rastersz, name, strlen(name) + 1) ;
+
+  endphase(st, BDF2FON_TABLE, mark) ;
+  if ( st ) {
+    st->outputs++ ;
+    st->allocs += image == *result ? 3 : 4 ;    /* tmp, dedup, codeoff, image */
+  }
+
+  /* a caller's buffer too small for the worst case may still do */
+  if ( *result && image != *result ) {
+    if ( *size < (size_t)fhead->dfSize ) {
+      *size = fhead->dfSize ;
+      free(image) ;
+      return BDF2FON_ESPACE ;
+    }
+    memcpy(*result, image, fhead->dfSize) ;
+    free(image) ;
+    image = *result ;
+  }
+  *result = image ;
+  *size = fhead->dfSize ;
+  return BDF2FON_OK ;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Public API, see bdf2fon.h */
+
+/* Fail before parsing: BDF2FON_REUSE still gives up the font in *font */
+static int refuse(int flags, Bdf2fonFont **font, int err)
+{
+  if ( (flags & BDF2FON_REUSE) && *font ) {
+    freefont(*font) ;
+    *font = NULL ;
+  }
+  return err ;
+}
+
+int bdf2fon_parse(const char *data, size_t size, int flags,
+                  Bdf2fonStats *stats, Bdf2fonFont **font, long *errline)
+{
+  return bdf2fon_parsesubset(data, size, flags, NULL, stats, font, errline) ;
+}
+
+/* zlib's allocations, counted with the parse's own */
+static voidpf gzalloc(voidpf stats, uInt n, uInt size)
+{
+  if ( stats )
+    ((Bdf2fonStats *)stats)->allocs++ ;
+  return calloc(n, size) ;
+}
+
+static void gzfree(voidpf stats, voidpf p)
+{
+  free(p) ;
+}
+
+int bdf2fon_parsesubset(const char *data, size_t size, int flags,
+                        const unsigned char *chars, Bdf2fonStats *stats,
+                        Bdf2fonFont **font, long *errline)
+{
+  BdfInput in ;
+  z_stream z ;
+  Font *fnt ;
+  const char *bad, *p ;
+  size_t sizehint = size ;
+  int gzip, err ;
+
+  if ( font == NULL )
+    return BDF2FON_EINVAL ;
+  if ( data == NULL && size > 0 )
+    return refuse(flags, font, BDF2FON_EINVAL) ;
+  gzip = size >= 18 && (unsigned char)data[0] == 0x1f && (unsigned char)data[1] == 0x8b ;
+  memset(&in, 0, sizeof(in)) ;
+  if ( gzip ) {
+    /* the trailer holds the text size (of the last member, mod 2^32);
+       it only sizes the arena, so a wrong one costs no more than time */
+    const unsigned char *t = (const unsigned char *)data + size - 4 ;
+    sizehint = t[0] | t[1] << 8 | t[2] << 16 | (size_t)t[3] << 24 ;
+    if ( sizehint / 64 > size )
+      sizehint = size * 64 ;
+    memset(&z, 0, sizeof(z)) ;
+    z.zalloc = gzalloc ;
+    z.zfree = gzfree ;
+    z.opaque = stats ;
+    z.next_in = (Bytef *)data ;
+    z.avail_in = size ;
+    if ( inflateInit2(&z, 16 + MAX_WBITS) != Z_OK )
+      return refuse(flags, font, BDF2FON_ENOMEM) ;
+    in.z = &z ;
+    in.cap = GZBLOCK ;
+    if ( (in.buf = (char *)malloc(in.cap)) == NULL ) {
+      inflateEnd(&z) ;
+      return refuse(flags, font, BDF2FON_ENOMEM) ;
+    }
+    if ( stats )
+      stats->allocs++ ;
+    data = in.buf ;
+    size = 0 ;
+  }
+  fnt = newfont(sizehint, flags & BDF2FON_UNICODE ? NUNICODES : NCODES,
+                flags & BDF2FON_REUSE ? *font : NULL) ;
+  *font = NULL ;
+  if ( fnt == NULL )
+    err = BDF2FON_ENOMEM ;
+  else {
+    fnt->stats = stats ;
+    fnt->chars = chars ;
+    fnt->subset = chars != NULL ;
+    in.start = in.pos = in.mark = data ;
+    in.end = data + size ;
+    err = readbdf(&in, fnt, &bad) ;
+    fnt->chars = NULL ;         /* the caller's, only lent for the parse */
+    if ( err != BDF2FON_OK && errline ) {
+      *errline = 1 + in.lines ; /* only counted when something went wrong */
+      for ( p = in.start ; (p = (const char *)memchr(p, '\n', bad - p)) != NULL ; p++ )
+        ++*errline ;
+    }
+    /* bad BDF may only be what corrupt gzip data inflated to: if the
+       rest of the stream is broken, say that instead */
+    if ( err == BDF2FON_EPARSE && gzip )
+      do
+        in.mark = in.pos = in.end ;
+      while ( refill(&in) ) ;
+    if ( in.err )
+      err = in.err ;
+    if ( err != BDF2FON_OK )
+      freefont(fnt) ;
+    else
+      *font = fnt ;
+  }
+  if ( gzip ) {
+    inflateEnd(&z) ;
+    free(in.buf) ;
+  }
+  return err ;
+}
+
+int bdf2fon_scale(const Bdf2fonFont *font, int factor, Bdf2fonFont **scaled)
+{
+  if ( font == NULL || scaled == NULL || factor < 1 || factor > BDF2FON_MAXSCALE )
+    return BDF2FON_EINVAL ;
+  *scaled = scalefont(font, factor) ;
+  return *scaled ? BDF2FON_OK : BDF2FON_ENOMEM ;
+}
+
+/* "32-126,0xa0-0xff,U+20AC": decimal, or hex after 0x or U+ */
+static const char *scancode(const char *p, long *code)
+{
+  int base = 10 ;
+  long v = 0 ;
+  const char *digits ;
+
+  if ( (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) ||
+       ((p[0] == 'U' || p[0] == 'u') && p[1] == '+') ) {
+    base = 16 ;
+    p += 2 ;
+  }
+  for ( digits = p ; v < 0x10000 ; p++ ) {
+    int d = *p >= '0' && *p <= '9' ? *p - '0' :
+            base == 16 && *p >= 'a' && *p <= 'f' ? *p - 'a' + 10 :
+            base == 16 && *p >= 'A' && *p <= 'F' ? *p - 'A' + 10 : -1 ;
+    if ( d < 0 )
+      break ;
+    v = v * base + d ;
+  }
+  *code = v ;
+  return p > digits && v < 0x10000 ? p : NULL ;
+}
+
+int bdf2fon_charset(const char *spec, unsigned char *set)
+{
+  const char *p = spec ;
+  long first, last, c ;
+
+  if ( spec == NULL || set == NULL )
+    return BDF2FON_EINVAL ;
+  memset(set, 0, BDF2FON_CHARSETSIZE) ;
+  do {
+    if ( (p = scancode(p, &first)) == NULL )
+      return BDF2FON_EINVAL ;
+    last = first ;
+    if ( *p == '-' && ((p = scancode(p + 1, &last)) == NULL || last < first) )
+      return BDF2FON_EINVAL ;
+    for ( c = first ; c <= last ; c++ )
+      set[c >> 3] |= 1 << (c & 7) ;
+  } while ( *p++ == ',' ) ;
+  return p[-1] == '\0' ? BDF2FON_OK : BDF2FON_EINVAL ;
+}
+
+void bdf2fon_free(Bdf2fonFont *font)
+{
+  if ( font )
+    freefont(font) ;
+}
+
+int bdf2fon_fnt(const Bdf2fonFont *font, const Bdf2fonOptions *options,
+                unsigned char **image, size_t *size)
+{
+  const Codepage *cp = NULL ;
+  int version ;
+
+  if ( font == NULL || options == NULL || image == NULL || size == NULL )
+    return BDF2FON_EINVAL ;
+  version = options->version ? options->version : BDF2FON_WINDOWS_2 ;
+  if ( version != BDF2FON_WINDOWS_2 && version != BDF2FON_WINDOWS_3_0 &&
+       version != BDF2FON_WINDOWS_3_1 )
+    return BDF2FON_EINVAL ;
+  if ( options->codepage && (cp = findcodepage(options->codepage)) == NULL )
+    return BDF2FON_EINVAL ;
+  return buildfnt(font, version, options->name, options->oem, cp, image, size) ;
+}
+
+int bdf2fon_fon(const unsigned char *const *fnts, const size_t *sizes,
+                int nfnts, unsigned char **image, size_t *size)
+{
+  FonFont *fonts ;
+  unsigned char *fon ;
+  long total ;
+  int i ;
+
+  if ( fnts == NULL || sizes == NULL || nfnts <= 0 || image == NULL || size == NULL )
+    return BDF2FON_EINVAL ;
+  if ( (fonts = (FonFont *)calloc(nfnts, sizeof(FonFont))) == NULL )
+    return BDF2FON_ENOMEM ;
+
+  /* the header, face name and size of each image are all the .fon uses */
+  for ( i = 0 ; i < nfnts ; i++ ) {
+    FONTFILEHEADER head ;
+
+    if ( sizes[i] < FON_FNTHDR )
+      break ;
+    memset(&head, 0, sizeof(head)) ;
+    memcpy(&head, fnts[i], sizes[i] < sizeof(head) ? sizes[i] : sizeof(head)) ;
+    if ( (head.dfVersion != 0x200 && head.dfVersion != 0x300) ||
+         head.dfSize < FON_FNTHDR || (size_t)head.dfSize > sizes[i] ||
+         head.dffi.dfFace < 0 || head.dffi.dfFace >= head.dfSize ||
+         memchr(fnts[i] + head.dffi.dfFace, 0, head.dfSize - head.dffi.dfFace) == NULL )
+      break ;
+    fonts[i].fnt = fnts[i] ;
+    fonts[i].size = head.dfSize ;
+    fonts[i].face = (const char *)fnts[i] + head.dffi.dfFace ;
+  }
+  if ( i < nfnts ) {
+    free(fonts) ;
+    return BDF2FON_EINVAL ;
+  }
+
+  /* fon.c lays out and assembles the file, as for fnt2fon */
+  total = *image ? (long)*size : 0 ;
+  fon = buildfon(fonts, nfnts, *image, &total) ;
+  free(fonts) ;
+  if ( fon == NULL && total > 0 ) {
+    *size = total ;
+    return BDF2FON_ESPACE ;
+  }
+  if ( fon == NULL )
+    return total < 0 ? BDF2FON_EFONBIG : BDF2FON_ENOMEM ;
+  *image = fon ;
+  *size = total ;
+  return BDF2FON_OK ;
+}
+
+void bdf2fon_release(void *image)
+{
+  free(image) ;
+}
+
+const char *bdf2fon_strerror(int err)
+{
+  switch ( err ) {
+  case BDF2FON_OK:        return "no error" ;
+  case BDF2FON_ENOMEM:    return "memory exhausted" ;
+  case BDF2FON_EPARSE:    return "can't parse BDF" ;
+  case BDF2FON_ENOGLYPHS: return "no glyphs to write" ;
+  case BDF2FON_ENONAME:   return "no font name" ;
+  case BDF2FON_EINVAL:    return "invalid argument" ;
+  case BDF2FON_ESPACE:    return "output buffer too small" ;
+  case BDF2FON_ETOOBIG:   return "font too large for a 2.x .fnt; use 3.0" ;
+  case BDF2FON_EFONBIG:   return "fonts too large for one .fon" ;
+  case BDF2FON_EGZIP:     return "corrupt or truncated gzip data" ;
+  default:                return "unknown error" ;
+  }
+}
+
+const char *bdf2fon_phasename(int phase)
+{
+  return phase >= 0 && phase < BDF2FON_NPHASES ? phasenames[phase] : NULL ;
+}
+
+const char *bdf2fon_keywordname(int keyword)
+{
+  return keyword >= 0 && keyword < BDF_NKEYWORDS ? dispatch[keyword].name :
+         keyword == BDF_NKEYWORDS ? "other" : NULL ;
+}
@@ -0,0 +1,126 @@
+/*
+ * bdf2fon.h - convert X11 BDF fonts to Windows .fnt and .fon images in
+ * memory.  Nothing here reads or writes files, prints or exits: every
+ * function returns BDF2FON_OK or one of the error codes below.  Fonts
+ * are independent of each other, so different threads may each work on
+ * their own.
+ *
+ * Released under the terms of GNU General Public License
+ * (GPL) version 2 (See: http://www.fsf.org/licenses/gpl.html)
+ */
+
+#ifndef BDF2FON_H
+#define BDF2FON_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BDF2FON_OK          0
+#define BDF2FON_ENOMEM      (-1)  /* out of memory */
+#define BDF2FON_EPARSE      (-2)  /* malformed BDF; see errline */
+#define BDF2FON_ENOGLYPHS   (-3)  /* no glyphs in the output's range */
+#define BDF2FON_ENONAME     (-4)  /* no face name given or in the BDF */
+#define BDF2FON_EINVAL      (-5)  /* bad argument, option or .fnt image */
+#define BDF2FON_ESPACE      (-6)  /* caller's buffer too small; *size says
+                                     how much is needed */
+#define BDF2FON_ETOOBIG     (-7)  /* over 64K, too large for a 2.x .fnt */
+#define BDF2FON_EFONBIG     (-8)  /* over 2GB, too large for one .fon */
+#define BDF2FON_EGZIP       (-9)  /* corrupt or truncated gzip input */
+
+/* .fnt versions; 3.0 and 3.1 both write the 3.x format (dfVersion 0x300),
+   whose 32-bit glyph offsets have no 64K limit */
+#define BDF2FON_WINDOWS_2   0x200
+#define BDF2FON_WINDOWS_3_0 0x300
+#define BDF2FON_WINDOWS_3_1 0x30a
+
+/* bdf2fon_parse() flags */
+#define BDF2FON_UNICODE     1     /* keep the whole BMP, for code pages */
+#define BDF2FON_REUSE       2     /* *font is an earlier font to replace;
+                                     its memory is kept for this one */
+
+#define BDF2FON_MAXSCALE    8
+
+/* A set of code points: bit c % 8 of byte c / 8 for each c in the BMP */
+#define BDF2FON_CHARSETSIZE (0x10000 / 8)
+
+/* Work counted while parsing and encoding, when asked for.  Phases and
+   keywords are indexed as bdf2fon_phasename() and bdf2fon_keywordname()
+   name them; the last keyword counts unknown ones. */
+enum {
+  BDF2FON_PARSE, BDF2FON_SCALE, BDF2FON_METRICS, BDF2FON_RASTER,
+  BDF2FON_TABLE, BDF2FON_NPHASES
+} ;
+#define BDF2FON_NKEYWORDS 20
+
+typedef struct {
+  double wall[BDF2FON_NPHASES], cpu[BDF2FON_NPHASES] ;  /* seconds */
+  int glyphs ;                  /* STARTCHARs read */
+  int outputs ;                 /* .fnt images built */
+  int keywords[BDF2FON_NKEYWORDS + 1] ;
+  int allocs ;                  /* heap blocks and buffers */
+} Bdf2fonStats ;
+
+typedef struct {
+  int version ;                 /* BDF2FON_WINDOWS_*, 0 for 2.x */
+  int oem ;                     /* force the OEM (console) character set */
+  int codepage ;                /* map bytes through this code page
+                                   (437, 850, ... 1257), 0 for none */
+  const char *name ;            /* face name, NULL for the BDF family */
+} Bdf2fonOptions ;
+
+typedef struct bdf2fon_font Bdf2fonFont ;
+
+/* Parse size bytes of BDF text; data need not be NUL terminated.  Data
+   starting with the gzip magic bytes (1f 8b), such as a .bdf.gz, is
+   inflated 256K at a time as the parser goes, so the text is never all
+   in memory (the library needs -lz).  Work is added to *stats, if not
+   NULL, until the font is freed.  On
+   BDF2FON_EPARSE, *errline (if not NULL) gets the 1-based line.  With
+   BDF2FON_REUSE, a font (or NULL) already in *font is freed whatever the
+   result, keeping its largest block of memory for the new font; a server
+   parsing one request after another then stays on warm pages. */
+int bdf2fon_parse(const char *data, size_t size, int flags,
+                  Bdf2fonStats *stats, Bdf2fonFont **font, long *errline) ;
+
+/* As bdf2fon_parse(), but glyphs whose ENCODING is not in the charset
+   chars (BDF2FON_CHARSETSIZE bytes, NULL for all) are skipped to their
+   ENDCHAR without being decoded or stored */
+int bdf2fon_parsesubset(const char *data, size_t size, int flags,
+                        const unsigned char *chars, Bdf2fonStats *stats,
+                        Bdf2fonFont **font, long *errline) ;
+
+/* Fill the charset set from a list of code points and ranges such as
+   "32-126,0xa0-0xff,U+20AC" (decimal, or hex after 0x or U+) */
+int bdf2fon_charset(const char *spec, unsigned char *set) ;
+
+/* A copy of font with every pixel a factor by factor block, 1 to
+   BDF2FON_MAXSCALE.  It refers to font, so free it first. */
+int bdf2fon_scale(const Bdf2fonFont *font, int factor, Bdf2fonFont **scaled) ;
+
+void bdf2fon_free(Bdf2fonFont *font) ;
+
+/* Encode a .fnt image.  With *image NULL the library allocates it (free
+   with bdf2fon_release()); otherwise it is built in the caller's *size
+   bytes at *image.  Either way *size gets the image size. */
+int bdf2fon_fnt(const Bdf2fonFont *font, const Bdf2fonOptions *options,
+                unsigned char **image, size_t *size) ;
+
+/* Put nfnts .fnt images of the given sizes into one .fon image, with the
+   same buffer rules as bdf2fon_fnt() */
+int bdf2fon_fon(const unsigned char *const *fnts, const size_t *sizes,
+                int nfnts, unsigned char **image, size_t *size) ;
+
+void bdf2fon_release(void *image) ;
+
+const char *bdf2fon_strerror(int err) ;
+const char *bdf2fon_phasename(int phase) ;
+const char *bdf2fon_keywordname(int keyword) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
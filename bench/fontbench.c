@@ -0,0 +1,317 @@
+/*
+ * fontbench.c - time each stage of a conversion on synthetic fonts of
+ * several shapes (see genbdf.c): bdf2fon_parse() on the BDF text,
+ * bdf2fon_fnt() from the parsed font, and .fon assembly, both
+ * bdf2fon_fon() in memory and the fnt2fon program on .fnt files.
+ * Shapes with code points past 255 are read as Unicode and written
+ * through code page 1252, and also parsed keeping only ASCII, as
+ * --chars 32-126 does.
+ *
+ * Every timing is written as "stage shape value unit" to the results
+ * file.  Given a baseline in the same format, each result is compared
+ * with it and the run fails if any is slower by more than the tolerance.
+ *
+ * Usage: fontbench [-o results] [-b baseline] [-t percent] [-f fnt2fon]
+ */
+
+#include "../bdf2fon.c"
+#define main genbdf_main
+#include "genbdf.c"
+#undef main
+
+static const char *program ;
+
+static void *xalloc(size_t num, size_t size)
+{
+  void *mem ;
+
+  if ( (mem = calloc(num, size)) == (void *)0 ) {
+    fprintf(stderr, "%s: memory exhausted\n", program) ;
+    exit(1) ;
+  }
+  return mem ;
+}
+
+static const struct {
+  const char *name ;
+  int px, glyphs, proportional ;
+} shapes[] = {
+  { "fixed-6px-95", 6, 95, 0 },
+  { "prop-12px-191", 12, 191, 1 },
+  { "fixed-16px-191", 16, 191, 0 },
+  { "prop-24px-191", 24, 191, 1 },
+  { "prop-64px-191", 64, 191, 1 },
+  { "fixed-16px-4000", 16, 4000, 0 },
+  { "prop-12px-65000", 12, 65000, 1 },
+} ;
+#define NSHAPES (int)(sizeof(shapes) / sizeof(shapes[0]))
+
+typedef struct {
+  char key[64] ;
+  double value ;
+} Result ;
+
+static Result results[5 * NSHAPES] ;
+static int nresults ;
+
+static double now(void)
+{
+  struct timespec ts ;
+  clock_gettime(CLOCK_MONOTONIC, &ts) ;
+  return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+/* Seconds per call of fn: the best of five batches of at least 40 ms */
+static double timeit(int (*fn)(void *), void *arg)
+{
+  double best = 0 ;
+  int batch ;
+
+  for ( batch = 0 ; batch < 5 ; batch++ ) {
+    double start = now(), elapsed ;
+    long calls = 0 ;
+    do {
+      if ( ! fn(arg) ) {
+        fprintf(stderr, "%s: benchmark step failed\n", program) ;
+        exit(1) ;
+      }
+      calls++ ;
+    } while ( (elapsed = now() - start) < 0.04 ) ;
+    if ( batch == 0 || elapsed / calls < best )
+      best = elapsed / calls ;
+  }
+  return best ;
+}
+
+static void report(const char *stage, const char *shape, double seconds)
+{
+  Result *r = &results[nresults++] ;
+
+  snprintf(r->key, sizeof(r->key), "%s %s", stage, shape) ;
+  r->value = seconds * 1e6 ;
+  printf("%-8s %-16s %12.1f us\n", stage, shape, r->value) ;
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+  char *bdf ;
+  size_t size ;
+  int flags ;
+  unsigned char ascii[BDF2FON_CHARSETSIZE] ;
+  Bdf2fonFont *fnt ;            /* parsed once for the later stages */
+  Bdf2fonOptions options ;
+  const unsigned char **fnts ;
+  size_t *sizes ;
+  int nfnts ;
+} Bench ;
+
+static int stepread(void *arg)
+{
+  Bench *b = (Bench *)arg ;
+  Bdf2fonFont *fnt ;
+
+  if ( bdf2fon_parse(b->bdf, b->size, b->flags, NULL, &fnt, NULL) != BDF2FON_OK )
+    return 0 ;
+  bdf2fon_free(fnt) ;
+  return 1 ;
+}
+
+static int stepsubset(void *arg)
+{
+  Bench *b = (Bench *)arg ;
+  Bdf2fonFont *fnt ;
+
+  if ( bdf2fon_parsesubset(b->bdf, b->size, b->flags, b->ascii, NULL, &fnt, NULL) != BDF2FON_OK )
+    return 0 ;
+  bdf2fon_free(fnt) ;
+  return 1 ;
+}
+
+static int stepwrite(void *arg)
+{
+  Bench *b = (Bench *)arg ;
+  unsigned char *image = NULL ;
+  size_t size ;
+
+  if ( bdf2fon_fnt(b->fnt, &b->options, &image, &size) != BDF2FON_OK )
+    return 0 ;
+  bdf2fon_release(image) ;
+  return 1 ;
+}
+
+static int stepfon(void *arg)
+{
+  Bench *b = (Bench *)arg ;
+  unsigned char *fon = NULL ;
+  size_t size ;
+
+  if ( bdf2fon_fon(b->fnts, b->sizes, b->nfnts, &fon, &size) != BDF2FON_OK )
+    return 0 ;
+  bdf2fon_release(fon) ;
+  return 1 ;
+}
+
+static int steprun(void *arg)
+{
+  return system((const char *)arg) == 0 ;
+}
+
+/* The BDF text of a shape */
+static char *makebdf(int shape, size_t *size)
+{
+  char *buf = NULL ;
+  FILE *out = open_memstream(&buf, size) ;
+
+  if ( out == NULL || ! genbdf(out, shapes[shape].px, shapes[shape].glyphs,
+                               shapes[shape].proportional) ) {
+    fprintf(stderr, "%s: can't generate %s\n", program, shapes[shape].name) ;
+    exit(1) ;
+  }
+  fclose(out) ;
+  return buf ;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int saveresults(const char *path)
+{
+  FILE *out = fopen(path, "w") ;
+  int i ;
+
+  if ( out == NULL )
+    return 0 ;
+  for ( i = 0 ; i < nresults ; i++ )
+    fprintf(out, "%s %.2f us\n", results[i].key, results[i].value) ;
+  return fclose(out) == 0 ;
+}
+
+/* Returns the number of results slower than baseline by more than tol */
+static int compare(const char *path, double tol)
+{
+  FILE *in = fopen(path, "r") ;
+  char stage[32], shape[32], unit[8] ;
+  double old ;
+  int i, slower = 0 ;
+
+  if ( in == NULL ) {
+    fprintf(stderr, "%s: can't read baseline %s\n", program, path) ;
+    return 1 ;
+  }
+  printf("\ncompared with %s:\n", path) ;
+  while ( fscanf(in, "%31s %31s %lf %7s", stage, shape, &old, unit) == 4 ) {
+    char key[64] ;
+    snprintf(key, sizeof(key), "%s %s", stage, shape) ;
+    for ( i = 0 ; i < nresults && strcmp(results[i].key, key) != 0 ; i++ )
+      ;
+    if ( i == nresults || old <= 0 )
+      continue ;
+    printf("%-25s %12.1f -> %12.1f us  %+6.1f%%%s\n", key, old, results[i].value,
+           (results[i].value / old - 1) * 100,
+           results[i].value > old * (1 + tol) ? "  SLOWER" : "") ;
+    slower += results[i].value > old * (1 + tol) ;
+  }
+  fclose(in) ;
+  return slower ;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *output = "bench/results.txt" ;
+  const char *baseline = NULL ;
+  const char *fnt2fon = "./fnt2fon" ;
+  double tol = 0.25 ;
+  const unsigned char *fnts[NSHAPES] ;
+  size_t sizes[NSHAPES] ;
+  char dir[] = "/tmp/fontbench.XXXXXX" ;
+  char *cmd ;
+  size_t cmdlen ;
+  Bench b ;
+  int i, nfnts = 0 ;
+
+  program = argv[0] ;
+  for ( i = 1 ; i + 1 < argc ; i += 2 ) {
+    if ( strcmp(argv[i], "-o") == 0 )
+      output = argv[i + 1] ;
+    else if ( strcmp(argv[i], "-b") == 0 )
+      baseline = argv[i + 1] ;
+    else if ( strcmp(argv[i], "-t") == 0 )
+      tol = atof(argv[i + 1]) / 100 ;
+    else if ( strcmp(argv[i], "-f") == 0 )
+      fnt2fon = argv[i + 1] ;
+    else
+      break ;
+  }
+  if ( i < argc ) {
+    fprintf(stderr, "Usage: %s [-o results] [-b baseline] [-t percent] [-f fnt2fon]\n", program) ;
+    return 1 ;
+  }
+  if ( mkdtemp(dir) == NULL ) {
+    fprintf(stderr, "%s: can't make a temporary directory\n", program) ;
+    return 1 ;
+  }
+  cmdlen = strlen(fnt2fon) + sizeof(dir) * (NSHAPES + 2) + 64 ;
+  cmd = (char *)xalloc(cmdlen, 1) ;
+  sprintf(cmd, "%s", fnt2fon) ;
+
+  memset(&b, 0, sizeof(b)) ;
+  b.options.version = BDF2FON_WINDOWS_2 ;
+  b.options.name = "Bench" ;
+  bdf2fon_charset("32-126", b.ascii) ;
+  for ( i = 0 ; i < NSHAPES ; i++ ) {
+    int wide = shapes[i].glyphs > 191 ;
+
+    b.bdf = makebdf(i, &b.size) ;
+    b.flags = wide ? BDF2FON_UNICODE : 0 ;
+    b.options.codepage = wide ? 1252 : 0 ;
+    report("readbdf", shapes[i].name, timeit(stepread, &b)) ;
+    if ( wide )
+      report("readsub", shapes[i].name, timeit(stepsubset, &b)) ;
+
+    if ( bdf2fon_parse(b.bdf, b.size, b.flags, NULL, &b.fnt, NULL) != BDF2FON_OK )
+      return 1 ;
+    /* shapes past 64K only fit the 3.0 format */
+    b.options.version = BDF2FON_WINDOWS_2 ;
+    if ( ! stepwrite(&b) )
+      b.options.version = BDF2FON_WINDOWS_3_0 ;
+    report("writefnt", shapes[i].name, timeit(stepwrite, &b)) ;
+    if ( ! wide ) {
+      unsigned char *image = NULL ;
+      char path[sizeof(dir) + 16] ;
+      FILE *out ;
+
+      if ( bdf2fon_fnt(b.fnt, &b.options, &image, &sizes[nfnts]) != BDF2FON_OK )
+        return 1 ;
+      fnts[nfnts] = image ;
+      sprintf(path, "%s/%d.fnt", dir, nfnts) ;
+      if ( (out = fopen(path, "wb")) == NULL ||
+           fwrite(image, 1, sizes[nfnts], out) != sizes[nfnts] )
+        return 1 ;
+      fclose(out) ;
+      sprintf(cmd + strlen(cmd), " %s", path) ;
+      nfnts++ ;
+    }
+    bdf2fon_free(b.fnt) ;
+    free(b.bdf) ;
+  }
+
+  b.fnts = fnts ;
+  b.sizes = sizes ;
+  b.nfnts = nfnts ;
+  report("buildfon", "all-8bit", timeit(stepfon, &b)) ;
+  sprintf(cmd + strlen(cmd), " %s/all.fon 2>/dev/null", dir) ;
+  report("fnt2fon", "all-8bit", timeit(steprun, cmd)) ;
+
+  sprintf(cmd, "rm -rf %s", dir) ;
+  (void)system(cmd) ;
+  for ( i = 0 ; i < nfnts ; i++ )
+    bdf2fon_release((void *)fnts[i]) ;
+  free(cmd) ;
+
+  if ( ! saveresults(output) ) {
+    fprintf(stderr, "%s: can't write %s\n", program, output) ;
+    return 1 ;
+  }
+  printf("results in %s\n", output) ;
+  return baseline && compare(baseline, tol) != 0 ;
+}
@@ -0,0 +1,92 @@
+/*
+ * genbdf.c - write a synthetic BDF font of a given shape, for
+ * benchmarking: fixed or proportional, 6 to 64 px, any number of glyphs
+ * from 95 (printable ASCII) up to the whole BMP.  Glyphs past 126 take
+ * consecutive code points from 160 on.  Bitmaps are pseudo-random but the
+ * same on every run.
+ *
+ * Usage: genbdf [-p] px glyphs > font.bdf
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GENBDF_MAXCODE 0xffff
+
+/* Code point of the i-th glyph */
+static int gencode(int i)
+{
+  return i < 95 ? 32 + i : 160 + (i - 95) ;
+}
+
+/* Advance width of glyph i: 3/5 of the height when fixed, varying
+   between 1/3 and the full height when proportional */
+static int genwidth(int px, int proportional, int i)
+{
+  int w = (px * 3 + 4) / 5 ;
+
+  if ( proportional )
+    w = px / 3 + (i * 7 + i / 5) % (px - px / 3 + 1) ;
+  return w < 1 ? 1 : w ;
+}
+
+/* Returns 0 if the shape can't be made */
+static int genbdf(FILE *out, int px, int glyphs, int proportional)
+{
+  unsigned seed = 2009 ;
+  int ascent = px - px / 5, descent = px / 5 ;
+  int maxw = proportional ? px : genwidth(px, 0, 0) ;
+  int i, r, c ;
+
+  if ( px < 6 || px > 64 || glyphs < 1 || gencode(glyphs - 1) > GENBDF_MAXCODE )
+    return 0 ;
+  fprintf(out, "STARTFONT 2.1\n"
+          "FONT -Bench-Gen%s-Medium-R-Normal--%d-%d-75-75-%c-%d-ISO10646-1\n"
+          "SIZE %d 75 75\n"
+          "FONTBOUNDINGBOX %d %d 0 %d\n"
+          "STARTPROPERTIES 4\n"
+          "FONT_ASCENT %d\nFONT_DESCENT %d\nDEFAULT_CHAR 0\n"
+          "COPYRIGHT \"Synthetic benchmark font\"\n"
+          "ENDPROPERTIES\n"
+          "CHARS %d\n",
+          proportional ? "Prop" : "Fixed", px, px * 10,
+          proportional ? 'P' : 'C', maxw * 10, px, maxw, px, -descent,
+          ascent, descent, glyphs) ;
+  for ( i = 0 ; i < glyphs ; i++ ) {
+    int w = genwidth(px, proportional, i) ;
+    int stride = (w + 7) >> 3 ;
+    fprintf(out, "STARTCHAR U+%04X\nENCODING %d\nSWIDTH %d 0\nDWIDTH %d 0\n"
+            "BBX %d %d 0 %d\nBITMAP\n",
+            gencode(i), gencode(i), w * 1000 / px, w, w, px, -descent) ;
+    for ( r = 0 ; r < px ; r++ ) {
+      for ( c = 0 ; c < stride ; c++ ) {
+        int bits = 8 - (c == stride - 1 ? stride * 8 - w : 0) ;
+        seed = seed * 1103515245 + 12345 ;
+        fprintf(out, "%02X", (seed >> 16) & (0xff << (8 - bits)) & 0xff) ;
+      }
+      fputc('\n', out) ;
+    }
+    fputs("ENDCHAR\n", out) ;
+  }
+  fputs("ENDFONT\n", out) ;
+  return 1 ;
+}
+
+int main(int argc, char *argv[])
+{
+  int proportional = 0 ;
+
+  if ( argc > 1 && strcmp(argv[1], "-p") == 0 ) {
+    proportional = 1 ;
+    argc-- ;
+    argv++ ;
+  }
+  if ( argc != 3 || ! genbdf(stdout, atoi(argv[1]), atoi(argv[2]), proportional) ) {
+    fprintf(stderr, "Usage: genbdf [-p] px glyphs > font.bdf\n"
+            "  px from 6 to 64, glyphs from 1 to %d\n",
+            GENBDF_MAXCODE - 160 + 95 + 1) ;
+    return 1 ;
+  }
+  return fflush(stdout) != 0 ;
+}
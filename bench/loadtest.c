@@ -0,0 +1,211 @@
+/*
+ * loadtest.c - load a bdf2fnt -S server with the same conversion from
+ * several clients at once and report requests per second and latency
+ * percentiles.  Each client keeps one connection open for all of its
+ * requests.  With -e, each request instead runs the bdf2fnt program on
+ * the file, for comparison with a process per conversion.
+ *
+ * Usage: loadtest (-S socket | -e bdf2fnt) [-c clients] [-n requests]
+ *                 [-o "options"] file.bdf
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+extern char **environ ;
+
+static const char *program ;
+static const char *sockpath, *command, *options = "" ;
+static const char *file ;
+static char *bdf ;
+static size_t bdfsize ;
+static int nrequests = 1000 ;
+
+typedef struct {
+  pthread_t thread ;
+  double *latency ;             /* seconds, one per request */
+  int done ;
+} Client ;
+
+static double now(void)
+{
+  struct timespec ts ;
+  clock_gettime(CLOCK_MONOTONIC, &ts) ;
+  return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+static int sendall(int fd, const void *data, size_t size)
+{
+  size_t done ;
+
+  for ( done = 0 ; done < size ; ) {
+    ssize_t n = send(fd, (const char *)data + done, size - done, MSG_NOSIGNAL) ;
+    if ( n < 0 && errno == EINTR )
+      continue ;
+    if ( n <= 0 )
+      return 0 ;
+    done += n ;
+  }
+  return 1 ;
+}
+
+/* One request on fd: send, then read "ok size\n" and the image */
+static int request(int fd, const char *header, char **buf, size_t *cap)
+{
+  size_t have = 0, need = 0 ;
+  char *nl = NULL ;
+
+  if ( ! sendall(fd, header, strlen(header)) || ! sendall(fd, bdf, bdfsize) )
+    return 0 ;
+  for (;;) {
+    ssize_t n ;
+    if ( have == *cap && (*buf = (char *)realloc(*buf, *cap = *cap * 2 + 65536)) == NULL )
+      return 0 ;
+    if ( (n = read(fd, *buf + have, *cap - have)) < 0 && errno == EINTR )
+      continue ;
+    if ( n <= 0 )
+      return 0 ;
+    have += n ;
+    if ( nl == NULL && (nl = (char *)memchr(*buf, '\n', have)) != NULL ) {
+      if ( strncmp(*buf, "ok ", 3) != 0 ) {
+        fprintf(stderr, "%s: %.*s\n", program, (int)(nl - *buf), *buf) ;
+        return 0 ;
+      }
+      need = nl + 1 - *buf + strtoul(*buf + 3, NULL, 10) ;
+    }
+    if ( nl && have >= need )
+      return 1 ;
+  }
+}
+
+/* One request as a process: bdf2fnt -q file > /dev/null */
+static int runonce(void)
+{
+  posix_spawn_file_actions_t fa ;
+  char *argv[4] ;
+  pid_t pid ;
+  int status = -1, ok ;
+
+  argv[0] = (char *)command ;
+  argv[1] = "-q" ;
+  argv[2] = (char *)file ;
+  argv[3] = NULL ;
+  posix_spawn_file_actions_init(&fa) ;
+  posix_spawn_file_actions_addopen(&fa, 1, "/dev/null", O_WRONLY, 0) ;
+  ok = posix_spawn(&pid, command, &fa, NULL, argv, environ) == 0 &&
+       waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+       WEXITSTATUS(status) == 0 ;
+  posix_spawn_file_actions_destroy(&fa) ;
+  return ok ;
+}
+
+static void *client(void *arg)
+{
+  Client *c = (Client *)arg ;
+  char header[256] ;
+  char *buf = NULL ;
+  size_t cap = 0 ;
+  int fd = -1 ;
+
+  snprintf(header, sizeof(header), "fnt %s %lu\n", options, (unsigned long)bdfsize) ;
+  if ( sockpath ) {
+    struct sockaddr_un addr ;
+    memset(&addr, 0, sizeof(addr)) ;
+    addr.sun_family = AF_UNIX ;
+    strncpy(addr.sun_path, sockpath, sizeof(addr.sun_path) - 1) ;
+    if ( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+         connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ) {
+      fprintf(stderr, "%s: can't connect to %s: %s\n", program, sockpath, strerror(errno)) ;
+      return NULL ;
+    }
+  }
+  for ( c->done = 0 ; c->done < nrequests ; c->done++ ) {
+    double start = now() ;
+    if ( ! (sockpath ? request(fd, header, &buf, &cap) : runonce()) )
+      break ;
+    c->latency[c->done] = now() - start ;
+  }
+  if ( fd >= 0 )
+    close(fd) ;
+  free(buf) ;
+  return NULL ;
+}
+
+static int cmpdouble(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b ;
+  return x < y ? -1 : x > y ;
+}
+
+int main(int argc, char *argv[])
+{
+  Client *clients ;
+  double *all, start, elapsed ;
+  FILE *in ;
+  int nclients = 4, i, total = 0 ;
+
+  program = argv[0] ;
+  for ( i = 1 ; i + 1 < argc ; i += 2 ) {
+    if ( strcmp(argv[i], "-S") == 0 )
+      sockpath = argv[i + 1] ;
+    else if ( strcmp(argv[i], "-e") == 0 )
+      command = argv[i + 1] ;
+    else if ( strcmp(argv[i], "-c") == 0 )
+      nclients = atoi(argv[i + 1]) ;
+    else if ( strcmp(argv[i], "-n") == 0 )
+      nrequests = atoi(argv[i + 1]) ;
+    else if ( strcmp(argv[i], "-o") == 0 )
+      options = argv[i + 1] ;
+    else
+      break ;
+  }
+  if ( i + 1 != argc || ! sockpath == ! command || nclients < 1 || nrequests < 1 ) {
+    fprintf(stderr, "Usage: %s (-S socket | -e bdf2fnt) [-c clients] [-n requests]\n"
+                    "       [-o \"options\"] file.bdf\n", program) ;
+    return 1 ;
+  }
+  file = argv[i] ;
+  if ( (in = fopen(file, "rb")) == NULL || fseek(in, 0, SEEK_END) != 0 ||
+       (bdfsize = ftell(in)) == 0 || (bdf = (char *)malloc(bdfsize)) == NULL ||
+       fseek(in, 0, SEEK_SET) != 0 || fread(bdf, 1, bdfsize, in) != bdfsize ) {
+    fprintf(stderr, "%s: can't read %s\n", program, file) ;
+    return 1 ;
+  }
+  fclose(in) ;
+
+  clients = (Client *)calloc(nclients, sizeof(Client)) ;
+  all = (double *)malloc((size_t)nclients * nrequests * sizeof(double)) ;
+  for ( i = 0 ; i < nclients ; i++ )
+    clients[i].latency = all + (size_t)i * nrequests ;
+  start = now() ;
+  for ( i = 0 ; i < nclients ; i++ )
+    if ( pthread_create(&clients[i].thread, NULL, client, &clients[i]) != 0 )
+      return 1 ;
+  for ( i = 0 ; i < nclients ; i++ )
+    pthread_join(clients[i].thread, NULL) ;
+  elapsed = now() - start ;
+
+  /* pack the latencies of finished requests together, then sort them */
+  for ( i = 0 ; i < nclients ; i++ ) {
+    memmove(all + total, clients[i].latency, clients[i].done * sizeof(double)) ;
+    total += clients[i].done ;
+  }
+  if ( total == 0 )
+    return 1 ;
+  qsort(all, total, sizeof(double), cmpdouble) ;
+  printf("%-7s %3d clients %7d requests %9.0f req/s  p50 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+         sockpath ? "server" : "process", nclients, total, total / elapsed,
+         all[total / 2] * 1e3, all[(int)(total * 0.99)] * 1e3, all[total - 1] * 1e3) ;
+  return total == nclients * nrequests ? 0 : 1 ;
+}
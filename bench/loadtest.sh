@@ -0,0 +1,27 @@
+#!/bin/sh
+# Load test of bdf2fnt -S: requests per second and latency percentiles at
+# a few client counts, then the same conversion run as one bdf2fnt process
+# per request for comparison.  Run from the top directory, as "make
+# loadtest" does.  Usage: bench/loadtest.sh [px glyphs]
+
+px=${1:-16}
+glyphs=${2:-191}
+dir=$(mktemp -d /tmp/loadtest.XXXXXX) || exit 1
+pid=
+trap '[ -n "$pid" ] && kill $pid; rm -rf "$dir"' EXIT
+
+bench/genbdf $px $glyphs > "$dir/font.bdf" || exit 1
+./bdf2fnt -S "$dir/sock" &
+pid=$!
+tries=0
+while [ ! -S "$dir/sock" ]; do
+  tries=$((tries + 1))
+  [ $tries -gt 100 ] && { echo "$0: server did not start" >&2; exit 1; }
+  sleep 0.05
+done
+
+echo "${px}px, $glyphs glyphs, $(wc -c < "$dir/font.bdf") bytes of BDF"
+for clients in 1 4 16; do
+  bench/loadtest -S "$dir/sock" -c $clients -n 2000 "$dir/font.bdf" || exit 1
+done
+bench/loadtest -e ./bdf2fnt -c 4 -n 100 "$dir/font.bdf"
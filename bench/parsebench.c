@@ -0,0 +1,235 @@
+/*
+ * parsebench.c - microbenchmark of the BDF line classifier and integer
+ * scanner in bdf2fon.c against the previous dispatch[] scan plus sscanf,
+ * and of the BITMAP row decoders against each other.  The keyword paths
+ * are checked for identical results before their timing is reported;
+ * test/hexrow checks the row decoders under "make check".  Also reports
+ * the heap calls readbdf() makes per font, which should not grow with
+ * the number of glyphs.
+ *
+ * Usage: parsebench [glyphs [rounds]]
+ */
+
+#include "../bdf2fon.c"
+
+#define MAX_LINE 512               /* the old fgets() buffer */
+
+static const char *program ;
+
+static void *xalloc(size_t num, size_t size)
+{
+  void *mem ;
+
+  if ( (mem = calloc(num, size)) == (void *)0 ) {
+    fprintf(stderr, "%s: memory exhausted\n", program) ;
+    exit(1) ;
+  }
+  return mem ;
+}
+
+static double now(void)
+{
+  struct timespec ts ;
+  clock_gettime(CLOCK_MONOTONIC, &ts) ;
+  return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+/* Synthesize glyph records the way a typical BDF lays them out */
+static char *makeinput(int glyphs, size_t *size)
+{
+  size_t max = (size_t)glyphs * 256 + 1 ;
+  char *buf = (char *)xalloc(max, 1) ;
+  size_t n = 0 ;
+  int i, r ;
+
+  for ( i = 0 ; i < glyphs ; i++ ) {
+    n += sprintf(buf + n, "STARTCHAR C%04x\nENCODING %d\nSWIDTH %d 0\n"
+                 "DWIDTH %d 0\nBBX %d 4 %d -1\nBITMAP\n",
+                 i, i & 255, 500 + i % 100, 8 + i % 5, 6 + i % 3, i % 2) ;
+    for ( r = 0 ; r < 4 ; r++ )
+      n += sprintf(buf + n, "%04X\n", (i * 7919 + r) & 0xffff) ;
+    n += sprintf(buf + n, "ENDCHAR\n") ;
+  }
+  *size = n ;
+  return buf ;
+}
+
+/* The original readbdf() inner loop: linear dispatch[] scan, then sscanf */
+static long oldpath(const char *line, int len)
+{
+  char buf[MAX_LINE] ;
+  const char *eow ;
+  int index, v[4] ;
+
+  memcpy(buf, line, len) ;      /* fgets copied every line */
+  buf[len] = '\0' ;
+  for ( eow = buf ; *eow && ! isspace((unsigned char)*eow) ; eow++ ) ;
+  for ( index = 0 ; dispatch[index].name ; index++ )
+    if ( strlen(dispatch[index].name) == eow - buf &&
+         strncmp(dispatch[index].name, buf, eow - buf) == 0 )
+      break ;
+  switch ( index ) {
+  case BDF_ENCODING:
+    return sscanf(eow, "%d\n", &v[0]) == 1 ? v[0] : -1 ;
+  case BDF_DWIDTH:
+    return sscanf(eow, "%d %d\n", &v[0], &v[1]) == 2 ? v[0] + v[1] : -1 ;
+  case BDF_BBX:
+    return sscanf(eow, "%d %d %d %d\n", &v[0], &v[1], &v[2], &v[3]) == 4 ?
+      v[0] + v[1] + v[2] + v[3] : -1 ;
+  }
+  return index ;
+}
+
+static long newpath(const char *line, int len)
+{
+  const char *eol = line + len, *eow ;
+  int index, v[4] ;
+
+  for ( eow = line ; eow < eol && *eow != ' ' && *eow != '\t' && *eow != '\r' ; eow++ ) ;
+  switch ( index = bdfkeyword(line, eow - line) ) {
+  case BDF_ENCODING:
+    return scanints(eow, eol, v, 1) == 1 ? v[0] : -1 ;
+  case BDF_DWIDTH:
+    return scanints(eow, eol, v, 2) == 2 ? v[0] + v[1] : -1 ;
+  case BDF_BBX:
+    return scanints(eow, eol, v, 4) == 4 ? v[0] + v[1] + v[2] + v[3] : -1 ;
+  }
+  return index < 0 ? BDF_NKEYWORDS : index ;
+}
+
+static double run(long (*path)(const char *, int), const char *buf,
+                  size_t size, int rounds, long *sum, long *lines)
+{
+  double start = now() ;
+  int round ;
+
+  *sum = *lines = 0 ;
+  for ( round = 0 ; round < rounds ; round++ ) {
+    const char *p = buf, *end = buf + size ;
+    while ( p < end ) {
+      const char *nl = (const char *)memchr(p, '\n', end - p) ;
+      *sum += path(p, nl - p) ;
+      ++*lines ;
+      p = nl + 1 ;
+    }
+  }
+  return now() - start ;
+}
+
+/* A corpus of BITMAP rows, mostly hex with some short, blank-terminated
+   and invalid rows, each followed by '\n' */
+static char *makerows(int nrows, int rowlen, size_t *size)
+{
+  static const char chars[] = "0123456789abcdefABCDEF" ;
+  char *buf = (char *)xalloc((size_t)nrows * (rowlen + 1) + 1, 1) ;
+  unsigned seed = 12345 ;
+  size_t n = 0 ;
+  int i, j ;
+
+  for ( i = 0 ; i < nrows ; i++ ) {
+    int len = rowlen ;
+    seed = seed * 1103515245 + 12345 ;
+    if ( (seed >> 16) % 8 == 0 )
+      len = (seed >> 8) % (rowlen + 1) ;
+    for ( j = 0 ; j < len ; j++ ) {
+      seed = seed * 1103515245 + 12345 ;
+      buf[n++] = chars[(seed >> 16) % (sizeof(chars) - 1)] ;
+    }
+    if ( len && (seed >> 12) % 64 == 0 )
+      buf[n - 1 - (seed >> 20) % len] = "g \r-"[(seed >> 4) % 4] ;
+    buf[n++] = '\n' ;
+  }
+  *size = n ;
+  return buf ;
+}
+
+typedef int (*hexrowfn)(const char *, const char *, unsigned char *, int) ;
+
+static double decode(hexrowfn fn, const char *buf, size_t size, int ndigits,
+                     int rounds, unsigned char *out, long *nrows)
+{
+  double start = now() ;
+  int round ;
+
+  *nrows = 0 ;
+  for ( round = 0 ; round < rounds ; round++ ) {
+    const char *p = buf, *end = buf + size ;
+    unsigned char *o = out ;
+    *nrows = 0 ;
+    while ( p < end ) {
+      if ( ! (*o = fn(p, end + 1, o + 1, ndigits)) )
+        memset(o + 1, 0, ndigits / 2) ;   /* contents unspecified on error */
+      o += 1 + ndigits / 2 ;
+      p = (const char *)memchr(p, '\n', end - p) + 1 ;
+      ++*nrows ;
+    }
+  }
+  return now() - start ;
+}
+
+static void hexbench(int nrows, int rounds)
+{
+  static const int widths[] = { 8, 16, 32, 64, 128 } ;
+  int w ;
+
+  for ( w = 0 ; w < sizeof(widths) / sizeof(widths[0]) ; w++ ) {
+    int ndigits = widths[w] / 4 ;
+    size_t size, outsize = (size_t)nrows * (1 + ndigits / 2) ;
+    char *buf = makerows(nrows, ndigits + 2, &size) ;
+    unsigned char *out = (unsigned char *)xalloc(outsize, 1) ;
+    long rows ;
+    double t = decode(hexrow_scalar, buf, size, ndigits, rounds, out, &rows) ;
+
+    printf("hexrow %3d px: scalar %.1f ns/row", widths[w], t * 1e9 / rows / rounds) ;
+#ifdef HAVE_SIMD_HEXROW
+    t = decode(hexrow_sse2, buf, size, ndigits, rounds, out, &rows) ;
+    printf(", sse2 %.1f ns/row", t * 1e9 / rows / rounds) ;
+    if ( __builtin_cpu_supports("avx2") ) {
+      t = decode(hexrow_avx2, buf, size, ndigits, rounds, out, &rows) ;
+      printf(", avx2 %.1f ns/row", t * 1e9 / rows / rounds) ;
+    }
+#endif
+    printf("\n") ;
+    free(buf) ;
+    free(out) ;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int glyphs = argc > 1 ? atoi(argv[1]) : 20000 ;
+  int rounds = argc > 2 ? atoi(argv[2]) : 20 ;
+  size_t size ;
+  char *buf ;
+  long oldsum, newsum, lines ;
+  double told, tnew ;
+  int n ;
+
+  program = argv[0] ;
+  buf = makeinput(glyphs, &size) ;
+  told = run(oldpath, buf, size, rounds, &oldsum, &lines) ;
+  tnew = run(newpath, buf, size, rounds, &newsum, &lines) ;
+
+  if ( oldsum != newsum ) {
+    fprintf(stderr, "%s: paths disagree (%ld != %ld)\n", program, oldsum, newsum) ;
+    return 1 ;
+  }
+  printf("keyword+int parse: dispatch/sscanf %.1f ns/line, "
+         "bdfkeyword/scanints %.1f ns/line (%.1fx)\n",
+         told * 1e9 / lines, tnew * 1e9 / lines, told / tnew) ;
+  free(buf) ;
+
+  for ( n = 95 ; n <= glyphs ; n *= 10 ) {
+    Font *fnt ;
+
+    buf = makeinput(n, &size) ;
+    if ( bdf2fon_parse(buf, size, 0, NULL, &fnt, NULL) != BDF2FON_OK )
+      return 1 ;
+    printf("readbdf: %d glyphs, %d heap calls\n", n, fnt->arena.nalloc) ;
+    bdf2fon_free(fnt) ;
+    free(buf) ;
+  }
+
+  hexbench(glyphs * 4, rounds) ;
+  return 0 ;
+}
@@ -0,0 +1,277 @@
+/*
+ * cache.c - content-addressed cache of converted font files, so that
+ * unchanged inputs skip parsing and encoding on the next build.
+ *
+ * Released under the terms of GNU General Public License
+ * (GPL) version 2 (See: http://www.fsf.org/licenses/gpl.html)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef unix
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+#include "cache.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/* SHA-256 (FIPS 180-4).  Entries are named by the digest alone, so it
+   has to be collision resistant: two inputs that collided would silently
+   get each other's output. */
+
+static const unsigned int sha256k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+} ;
+
+#define ROR(x, n) ((x) >> (n) | (x) << (32 - (n)))
+
+static void sha256block(unsigned int *state, const unsigned char *p)
+{
+  unsigned int w[64], v[8], t1, t2 ;
+  int i ;
+
+  for ( i = 0 ; i < 16 ; i++, p += 4 )
+    w[i] = (unsigned)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3] ;
+  for ( ; i < 64 ; i++ )
+    w[i] = (ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ w[i - 2] >> 10) + w[i - 7] +
+           (ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ w[i - 15] >> 3) + w[i - 16] ;
+  memcpy(v, state, sizeof(v)) ;
+  for ( i = 0 ; i < 64 ; i++ ) {
+    t1 = v[7] + (ROR(v[4], 6) ^ ROR(v[4], 11) ^ ROR(v[4], 25)) +
+         ((v[4] & v[5]) ^ (~v[4] & v[6])) + sha256k[i] + w[i] ;
+    t2 = (ROR(v[0], 2) ^ ROR(v[0], 13) ^ ROR(v[0], 22)) +
+         ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2])) ;
+    memmove(v + 1, v, 7 * sizeof(v[0])) ;
+    v[4] += t1 ;
+    v[0] = t1 + t2 ;
+  }
+  for ( i = 0 ; i < 8 ; i++ )
+    state[i] += v[i] ;
+}
+
+void cacheinit(CacheKey *key, const char *tag)
+{
+  static const unsigned int init[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+  } ;
+
+  memcpy(key->state, init, sizeof(init)) ;
+  key->length = 0 ;
+  cachehashstr(key, tag) ;
+}
+
+void cachehash(CacheKey *key, const void *data, size_t n)
+{
+  const unsigned char *p = (const unsigned char *)data ;
+  size_t have = key->length % 64 ;
+
+  key->length += n ;
+  if ( have ) {
+    size_t take = n < 64 - have ? n : 64 - have ;
+    memcpy(key->block + have, p, take) ;
+    p += take ;
+    n -= take ;
+    if ( have + take < 64 )
+      return ;
+    sha256block(key->state, key->block) ;
+  }
+  for ( ; n >= 64 ; p += 64, n -= 64 )
+    sha256block(key->state, p) ;
+  memcpy(key->block, p, n) ;
+}
+
+void cachehashint(CacheKey *key, long value)
+{
+  char buf[24] ;
+
+  sprintf(buf, "%ld", value) ;
+  cachehashstr(key, buf) ;
+}
+
+/* including the NUL, so "ab","c" and "a","bc" differ */
+void cachehashstr(CacheKey *key, const char *s)
+{
+  cachehash(key, s ? s : "", s ? strlen(s) + 1 : 0) ;
+}
+
+/* Entries are named by the hex digest of their key */
+static char *cachepath(const char *dir, const CacheKey *key)
+{
+  char *path = (char *)malloc(strlen(dir) + 66) ;
+  CacheKey last = *key ;        /* key may still be extended */
+  unsigned long long bits = key->length * 8 ;
+  unsigned char pad[72] = { 0x80 } ;
+  size_t npad = 64 + 56 - key->length % 64 ;
+  char *p ;
+  int i ;
+
+  if ( path == NULL )
+    return NULL ;
+  if ( npad > 64 )
+    npad -= 64 ;
+  for ( i = 0 ; i < 8 ; i++ )
+    pad[npad + i] = (unsigned char)(bits >> (56 - 8 * i)) ;
+  cachehash(&last, pad, npad + 8) ;
+  p = path + sprintf(path, "%s/", dir) ;
+  for ( i = 0 ; i < 8 ; i++ )
+    p += sprintf(p, "%08x", last.state[i]) ;
+  return path ;
+}
+
+/* write() all of data, going round again for short writes */
+static int writeall(int fd, const unsigned char *data, long size)
+{
+  while ( size > 0 ) {
+    ssize_t n = write(fd, data, size) ;
+    if ( n < 0 && errno == EINTR )
+      continue ;
+    if ( n <= 0 )
+      return 0 ;
+    data += n ;
+    size -= n ;
+  }
+  return 1 ;
+}
+
+/* Copy the whole of file from to the open file out */
+static int copyto(const char *from, int out)
+{
+  unsigned char buf[0x10000] ;
+  int in, ok = 1 ;
+  ssize_t n ;
+
+  if ( (in = open(from, O_RDONLY | O_BINARY)) < 0 )
+    return 0 ;
+  while ( ok && (n = read(in, buf, sizeof(buf))) != 0 ) {
+    if ( n < 0 ) {
+      ok = errno == EINTR ;
+      continue ;
+    }
+    ok = writeall(out, buf, n) ;
+  }
+  close(in) ;
+  return ok ;
+}
+
+int cacheget(const char *dir, const CacheKey *key, const char *outfile)
+{
+  char *path = cachepath(dir, key) ;
+  struct stat st ;
+  int hit = 0 ;
+
+  if ( path && stat(path, &st) == 0 ) {
+    int out ;
+    remove(outfile) ;
+#ifdef unix
+    hit = link(path, outfile) == 0 ;
+#endif
+    if ( ! hit && (out = open(outfile, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666)) >= 0 ) {
+      hit = copyto(path, out) ;
+      if ( close(out) != 0 )
+        hit = 0 ;
+      if ( ! hit )
+        remove(outfile) ;
+    }
+  }
+  free(path) ;
+  return hit ;
+}
+
+unsigned char *cacheread(const char *dir, const CacheKey *key, long *size)
+{
+  char *path = cachepath(dir, key) ;
+  unsigned char *data = NULL ;
+  struct stat st ;
+  int fd ;
+
+  if ( path && (fd = open(path, O_RDONLY | O_BINARY)) >= 0 ) {
+    if ( fstat(fd, &st) == 0 && (data = (unsigned char *)malloc(st.st_size + 1)) ) {
+      long done = 0 ;
+      ssize_t n ;
+      while ( done < st.st_size && (n = read(fd, data + done, st.st_size - done)) != 0 ) {
+        if ( n < 0 && errno == EINTR )
+          continue ;
+        if ( n < 0 )
+          break ;
+        done += n ;
+      }
+      if ( done != st.st_size ) {
+        free(data) ;
+        data = NULL ;
+      }
+      *size = done ;
+    }
+    close(fd) ;
+  }
+  free(path) ;
+  return data ;
+}
+
+/* Entries appear whole: written to a temporary name, then renamed.  They
+   are read-only, since outputs may be hard links to them. */
+static char *tempname(const char *path, int *fd)
+{
+  char *tmp = (char *)malloc(strlen(path) + 16) ;
+
+  if ( tmp == NULL )
+    return NULL ;
+  sprintf(tmp, "%s.XXXXXX", path) ;
+#ifdef unix
+  if ( (*fd = mkstemp(tmp)) >= 0 ) {
+    fchmod(*fd, 0444) ;
+    return tmp ;
+  }
+#else
+  if ( mktemp(tmp) && (*fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0444)) >= 0 )
+    return tmp ;
+#endif
+  free(tmp) ;
+  return NULL ;
+}
+
+void cacheput(const char *dir, const CacheKey *key, const unsigned char *data, long size)
+{
+  char *path = cachepath(dir, key) ;
+  char *tmp ;
+  int fd, ok ;
+
+  if ( path && (tmp = tempname(path, &fd)) != NULL ) {
+    ok = writeall(fd, data, size) ;
+    if ( close(fd) != 0 || ! ok || rename(tmp, path) != 0 )
+      remove(tmp) ;
+    free(tmp) ;
+  }
+  free(path) ;
+}
+
+void cacheputfile(const char *dir, const CacheKey *key, const char *file)
+{
+  char *path = cachepath(dir, key) ;
+  char *tmp ;
+  int fd, ok ;
+
+  if ( path && (tmp = tempname(path, &fd)) != NULL ) {
+    ok = copyto(file, fd) ;
+    if ( close(fd) != 0 || ! ok || rename(tmp, path) != 0 )
+      remove(tmp) ;
+    free(tmp) ;
+  }
+  free(path) ;
+}
@@ -0,0 +1,27 @@
+/*
+ * cache.h
+ */
+
+/* Content-addressed store of finished output files.  A key is a SHA-256
+   of everything the output depends on: the input bytes and each option.
+   The struct holds the hash state until cachepath() finishes a copy. */
+typedef struct {
+  unsigned int state[8] ;
+  unsigned long long length ;   /* bytes hashed so far */
+  unsigned char block[64] ;     /* the last length % 64 of them */
+} CacheKey ;
+
+void cacheinit(CacheKey *key, const char *tag) ;
+void cachehash(CacheKey *key, const void *data, size_t n) ;
+void cachehashint(CacheKey *key, long value) ;
+void cachehashstr(CacheKey *key, const char *s) ;
+
+/* On a hit, put the cached file at outfile (hard link, else copy), or
+   return it in memory; both return 0 on a miss */
+int cacheget(const char *dir, const CacheKey *key, const char *outfile) ;
+unsigned char *cacheread(const char *dir, const CacheKey *key, long *size) ;
+
+/* Store an output, from memory or from the file just written; failures
+   only cost the next run a miss */
+void cacheput(const char *dir, const CacheKey *key, const unsigned char *data, long size) ;
+void cacheputfile(const char *dir, const CacheKey *key, const char *file) ;
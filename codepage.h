@@ -0,0 +1,15 @@
+/*
+ * codepage.h
+ */
+
+typedef struct {
+  int id ;                      /* e.g. 1252 */
+  int charset ;                 /* dfCharSet to write */
+  const unsigned short *low ;   /* Unicode for bytes 0x00..0x7f, NULL if ASCII */
+  const unsigned short *high ;  /* Unicode for bytes 0x80..0xff */
+} Codepage ;
+
+extern const Codepage codepages[] ;
+
+const Codepage *findcodepage(int id) ;
+int codepagechar(const Codepage *cp, int c) ;
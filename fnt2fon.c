@@ -18,28 +18,48 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#define _GNU_SOURCE             /* copy_file_range */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
 #ifdef unix
 #include <unistd.h>
-#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#ifndef unix
 #include <io.h>
 #endif
 #include "fontstruc.h"
+#include "fon.h"
+#include "cache.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
-static const BYTE MZ_hdr[] = {
-    'M',  'Z',  0x0d, 0x01, 0x01, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00,
-    0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
-    0x0e, 0x1f, 0xba, 0x0e, 0x00, 0xb4, 0x09, 0xcd, 0x21, 0xb8, 0x01, 0x4c, 0xcd, 0x21, 'T',  'h',
-    'i',  's',  ' ',  'P',  'r',  'o',  'g',  'r',  'a',  'm',  ' ',  'c',  'a',  'n',  'n',  'o',
-    't',  ' ',  'b',  'e',  ' ',  'r',  'u',  'n',  ' ',  'i',  'n',  ' ',  'D',  'O',  'S',  ' ',
-    'm',  'o',  'd',  'e',  0x0d, 0x0a, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-};
+/* One input .fnt, read or mapped once and parsed up front */
+typedef struct {
+    const char *path;
+    unsigned char *data;    /* whole file */
+    size_t len;             /* bytes in data */
+    int mapped;
+    int fd;                 /* kept open for copying when mapped, else -1 */
+    short version;
+    long size;              /* dfSize */
+    short points;
+    short dpi[2];           /* vertical, horizontal */
+    const char *face;       /* points into data */
+    double wall[2], cpu[2]; /* --stats: seconds to read and to copy */
+} FntFile;
 
 static const char *output_file;
 
@@ -50,229 +70,382 @@ static void cleanup_files(void)
 
 static void usage(char **argv)
 {
-    fprintf(stderr, "%s fntfiles output.fon\n", argv[0]);
+    fprintf(stderr, "%s [-C cachedir] [--stats] fntfiles output.fon\n", argv[0]);
+    fprintf(stderr, "  a fntfile of - reads standard input\n");
+    fprintf(stderr, "  -C reuses an earlier output.fon built from the same fntfiles\n");
+    fprintf(stderr, "  --stats prints per-file times and I/O on stderr as JSON\n");
     return;
 }
 
-int main(int argc, char **argv)
+static double wallclock(void)
 {
-    int i, j;
-    FILE *fp, *ofp;
-    long off;
-    char name[200];
-    int c;
-    char *cp;
-    short pt, ver, dpi[2], align, num_files;
-    int resource_table_len, non_resident_name_len, resident_name_len;
-    unsigned short resource_table_off, resident_name_off, module_ref_off, non_resident_name_off, fontdir_off;
-    unsigned font_off;
-    char resident_name[200] = "";
-    int fontdir_len = 2;
-    char non_resident_name[200] = "";
-    int *file_lens, nread;
-    unsigned short first_res = 0x0050, pad, res;
-    FONTFILEHEADER *fnt_header;
-    char buf[0x1000];
-    IMAGE_OS2_HEADER NE_hdr;
-    NE_TYPEINFO rc_type;
-    NE_NAMEINFO rc_name;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-    if(argc < 3) {
-        usage(argv);
-        exit(1);
+static double cpuclock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Add the time since mark to wall and cpu, and restart mark */
+static void lap(double mark[2], double *wall, double *cpu)
+{
+    double w = wallclock(), c = cpuclock();
+    *wall += w - mark[0];
+    *cpu += c - mark[1];
+    mark[0] = w;
+    mark[1] = c;
+}
+
+static void jsonstr(FILE *out, const char *s)
+{
+    putc('"', out);
+    for(; *s; s++) {
+        unsigned char c = *s;
+        if(c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if(c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            putc(c, out);
     }
+    putc('"', out);
+}
 
-    num_files = argc - 2;
-    file_lens = malloc(num_files * sizeof(int));
+/* --stats report: one object per input, then the output and totals */
+static void printstats(FILE *out, FntFile *fnts, int num_files, const char *fonfile,
+                       long written, int cachehit, double header[2], double start)
+{
+    long read = 0;
+    int i;
+#ifdef unix
+    struct rusage ru;
+#endif
+
+    fprintf(out, "{\"program\": \"fnt2fon\", \"inputs\": [");
     for(i = 0; i < num_files; i++) {
-        fp = fopen(argv[i+1], "rb");
-        if(!fp) {
-            fprintf(stderr, "error: unable to open %s for reading: %s\n", argv[i+1], strerror(errno));
-            exit(1);
+        fprintf(out, "%s\n  {\"input\": ", i ? "," : "");
+        jsonstr(out, fnts[i].path);
+        fprintf(out, ", \"face\": ");
+        jsonstr(out, fnts[i].face ? fnts[i].face : "");
+        fprintf(out, ", \"bytes_read\": %ld, \"bytes_written\": %ld, \"mapped\": %d,\n"
+                "   \"phases\": {\"read\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}, "
+                "\"copy\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}}}",
+                (long)fnts[i].len, cachehit ? 0 : fnts[i].size, fnts[i].mapped,
+                fnts[i].wall[0] * 1e3, fnts[i].cpu[0] * 1e3,
+                fnts[i].wall[1] * 1e3, fnts[i].cpu[1] * 1e3);
+        read += fnts[i].len;
+    }
+    fprintf(out, "],\n \"output\": ");
+    jsonstr(out, fonfile);
+    fprintf(out, ", \"cache_hit\": %d, \"bytes_read\": %ld, \"bytes_written\": %ld,\n"
+            " \"phases\": {\"header\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}}, \"wall_ms\": %.3f",
+            cachehit, read, written, header[0] * 1e3, header[1] * 1e3,
+            (wallclock() - start) * 1e3);
+#ifdef unix
+    if(getrusage(RUSAGE_SELF, &ru) == 0)
+        fprintf(out, ", \"cpu_ms\": %.3f, \"peak_rss_kb\": %ld",
+                (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e3 +
+                (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-3, (long)ru.ru_maxrss);
+#endif
+    fprintf(out, "}\n");
+}
+
+/* Slurp a file we can't map, such as a pipe */
+static unsigned char *readall(int fd, size_t *len)
+{
+    size_t max = 0x4000, n = 0;
+    unsigned char *data = malloc(max), *p;
+
+    while(data) {
+        ssize_t got;
+        if(n == max) {
+            if(!(p = realloc(data, max *= 2))) break;
+            data = p;
         }
-        fread(&ver, sizeof(short), 1, fp);
-        if(ver != 0x200 && ver != 0x300) {
-            fprintf(stderr, "error: invalid fnt file %s ver %d\n", argv[i+1], ver);
-            exit(1);
+        got = read(fd, data + n, max - n);
+        if(got < 0 && errno == EINTR)
+            continue;
+        if(got < 0) break;
+        if(got == 0) {
+            *len = n;
+            return data;
         }
-        fread(file_lens + i, sizeof(int), 1, fp);
-        fseek(fp, 0x44, SEEK_SET);
-        fread(&pt, sizeof(short), 1, fp);
-        fread(dpi, sizeof(short), 2, fp);
-        fseek(fp, 0x69, SEEK_SET);
-        fread(&off, sizeof(long), 1, fp);
-        fseek(fp, off, SEEK_SET);
-        cp = name;
-        while((c = fgetc(fp)) != 0 && c != EOF)
-            *cp++ = c;
-        *cp = '\0';
-        fprintf(stderr, "%s %d pts %dx%d dpi\n", name, pt, dpi[0], dpi[1]);
-        fclose(fp);
-        /* fontdir entries for version 3 fonts are the same as for version 2 */
-        fontdir_len += 0x74 + strlen(name) + 1;
-        if(i == 0) {
-            sprintf(non_resident_name, "FONTRES 100,%d,%d : %s %d", dpi[0], dpi[1], name, pt);
-            strcpy(resident_name, name);
-        } else {
-            sprintf(non_resident_name + strlen(non_resident_name), ",%d", pt);
+        n += got;
+    }
+    free(data);
+    return NULL;
+}
+
+/* Read the file once and fill in the descriptor from its header */
+static int loadfnt(const char *path, FntFile *fnt)
+{
+    int fd = 0;
+    struct stat st;
+    FONTFILEHEADER hdr;
+    const unsigned char *nul;
+
+    memset(fnt, 0, sizeof(*fnt));
+    fnt->path = path;
+    fnt->fd = -1;
+    if(strcmp(path, "-") != 0 && (fd = open(path, O_RDONLY | O_BINARY)) < 0) {
+        fprintf(stderr, "error: unable to open %s for reading: %s\n", path, strerror(errno));
+        return 0;
+    }
+#ifdef unix
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        fnt->len = st.st_size;
+        fnt->data = mmap(NULL, fnt->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(fnt->data == MAP_FAILED)
+            fnt->data = NULL;
+        else {
+            fnt->mapped = 1;
+            fnt->fd = fd;
         }
     }
-    if(dpi[0] <= 108)
-        strcat(non_resident_name, " (VGA res)");
-    else
-        strcat(non_resident_name, " (8514 res)");
-    non_resident_name_len = strlen(non_resident_name) + 4;
+#endif
+    if(!fnt->data)
+        fnt->data = readall(fd, &fnt->len);
+    if(fd != 0 && fd != fnt->fd)
+        close(fd);
+    if(!fnt->data) {
+        fprintf(stderr, "error: unable to read %s: %s\n", path, strerror(errno));
+        return 0;
+    }
 
-    /* shift count + fontdir entry + num_files of font + nul type + \007FONTDIR */
-    resource_table_len = sizeof(align) + sizeof("FONTDIR") +
-                         sizeof(NE_TYPEINFO) + sizeof(NE_NAMEINFO) +
-                         sizeof(NE_TYPEINFO) + sizeof(NE_NAMEINFO) * num_files +
-                         sizeof(NE_TYPEINFO);
-    resource_table_off = sizeof(NE_hdr);
-    resident_name_off = resource_table_off + resource_table_len;
-    resident_name_len = strlen(resident_name) + 4;
-    module_ref_off = resident_name_off + resident_name_len;
-    non_resident_name_off = sizeof(MZ_hdr) + module_ref_off + sizeof(align);
+    if(fnt->len < FON_FNTHDR) {
+        fprintf(stderr, "error: invalid fnt file %s: too short\n", path);
+        return 0;
+    }
+    memcpy(&hdr, fnt->data, FON_FNTHDR);
+    fnt->version = hdr.dfVersion;
+    if(fnt->version != 0x200 && fnt->version != 0x300) {
+        fprintf(stderr, "error: invalid fnt file %s ver %d\n", path, fnt->version);
+        return 0;
+    }
+    fnt->size = hdr.dfSize;
+    fnt->points = hdr.dffi.dfPoints;
+    fnt->dpi[0] = hdr.dffi.dfVertRes;
+    fnt->dpi[1] = hdr.dffi.dfHorizRes;
+    if(fnt->size < FON_FNTHDR || (size_t)fnt->size > fnt->len ||
+       hdr.dffi.dfFace < 0 || hdr.dffi.dfFace >= fnt->size ||
+       !(nul = memchr(fnt->data + hdr.dffi.dfFace, 0, fnt->size - hdr.dffi.dfFace))) {
+        fprintf(stderr, "error: invalid fnt file %s: bad size or face name\n", path);
+        return 0;
+    }
+    fnt->face = (const char *)fnt->data + hdr.dffi.dfFace;
+    return 1;
+}
 
-    memset(&NE_hdr, 0, sizeof(NE_hdr));
-    NE_hdr.ne_magic = 0x454e;
-    NE_hdr.ne_ver = 5;
-    NE_hdr.ne_rev = 1;
-    NE_hdr.ne_flags = NE_FFLAGS_LIBMODULE | NE_FFLAGS_GUI;
-    NE_hdr.ne_cbnrestab = non_resident_name_len;
-    NE_hdr.ne_segtab = sizeof(NE_hdr);
-    NE_hdr.ne_rsrctab = sizeof(NE_hdr);
-    NE_hdr.ne_restab = resident_name_off;
-    NE_hdr.ne_modtab = module_ref_off;
-    NE_hdr.ne_imptab = module_ref_off;
-    NE_hdr.ne_enttab = NE_hdr.ne_modtab;
-    NE_hdr.ne_nrestab = non_resident_name_off;
-    NE_hdr.ne_align = 4;
-    NE_hdr.ne_exetyp = 2;//NE_OSFLAGS_WINDOWS;
-    NE_hdr.ne_expver = 0x400;
+static void freefnt(FntFile *fnt)
+{
+    if(fnt->fd > 0)
+        close(fnt->fd);
+    if(!fnt->data) return;
+#ifdef unix
+    if(fnt->mapped) {
+        munmap(fnt->data, fnt->len);
+        return;
+    }
+#endif
+    free(fnt->data);
+}
 
-    fontdir_off = (non_resident_name_off + non_resident_name_len + 15) & ~0xf;
-    font_off = (fontdir_off + fontdir_len + 15) & ~0x0f;
+/* Write len bytes from data at offset off of the output */
+static int writeat(int out, const unsigned char *data, long len, long off)
+{
+    while(len > 0) {
+#ifdef unix
+        ssize_t n = pwrite(out, data, len, off);
+#else
+        ssize_t n = lseek(out, off, SEEK_SET) < 0 ? -1 : write(out, data, len);
+#endif
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return 0;
+        data += n;
+        len -= n;
+        off += n;
+    }
+    return 1;
+}
 
-    atexit( cleanup_files );
+/* Copy a font body to offset off of the output.  Mapped inputs go file to
+   file in the kernel where it can; the rest are written from memory. */
+static int copybody(int out, FntFile *fnt, long off)
+{
+    long done = 0;
+
+#ifdef __linux__
+    if(fnt->fd >= 0) {
+        loff_t inoff = 0, outoff = off;
+        while(done < fnt->size) {
+            ssize_t n = copy_file_range(fnt->fd, &inoff, out, &outoff, fnt->size - done, 0);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                break;
+            done += n;
+        }
+        if(done < fnt->size && lseek(out, off + done, SEEK_SET) >= 0) {
+            off_t in = done;
+            while(done < fnt->size) {
+                ssize_t n = sendfile(out, fnt->fd, &in, fnt->size - done);
+                if(n < 0 && errno == EINTR)
+                    continue;
+                if(n <= 0)
+                    break;
+                done += n;
+            }
+        }
+    }
+#endif
+    return writeat(out, fnt->data + done, fnt->size - done, off + done);
+}
 
-    output_file = argv[argc - 1];
-    ofp = fopen(output_file, "wb");
-    if(!ofp) {
-        fprintf(stderr, "error: unable to open %s for writing: %s\n", output_file, strerror(errno));
+int main(int argc, char **argv)
+{
+    int i, num_files, out;
+    FntFile *fnts;
+    FonFont *fonts;
+    long hdrsize, total, *fontoff;
+    unsigned char *hdr;
+    const char *cachedir = NULL;
+    CacheKey key;
+    char **files;
+    int stats = 0;
+    double start = wallclock(), mark[2], header[2] = { 0, 0 };
+
+    for(;;) {
+        if(argc >= 3 && strcmp(argv[1], "-C") == 0) {
+            cachedir = argv[2];
+            argv[2] = argv[0];
+            argc -= 2;
+            argv += 2;
+        } else if(argc >= 2 && strcmp(argv[1], "--stats") == 0) {
+            stats = 1;
+            argv[1] = argv[0];
+            argc--;
+            argv++;
+        } else
+            break;
+    }
+    files = argv + 1;
+    if(argc < 3) {
+        usage(argv);
         exit(1);
     }
 
-    fwrite(MZ_hdr, sizeof(MZ_hdr), 1, ofp);
-    fwrite(&NE_hdr, sizeof(NE_hdr), 1, ofp);
-
-    align = 4;
-    fwrite(&align, sizeof(align), 1, ofp);
-
-    rc_type.type_id = NE_RSCTYPE_FONTDIR;
-    rc_type.count = 1;
-    rc_type.resloader = 0;
-    fwrite(&rc_type, sizeof(rc_type), 1, ofp);
-
-    rc_name.offset = fontdir_off >> 4;
-    rc_name.length = (fontdir_len + 15) >> 4;
-    rc_name.flags = 0xc00 | NE_SEGFLAGS_MOVEABLE | NE_SEGFLAGS_PRELOAD;
-    rc_name.id = resident_name_off - sizeof("FONTDIR") - NE_hdr.ne_rsrctab;
-    rc_name.handle = 0;
-    rc_name.usage = 0;
-    fwrite(&rc_name, sizeof(rc_name), 1, ofp);
-
-    rc_type.type_id = NE_RSCTYPE_FONT;
-    rc_type.count = num_files;
-    rc_type.resloader = 0;
-    fwrite(&rc_type, sizeof(rc_type), 1, ofp);
-
-    for(res = first_res | 0x8000, i = 0; i < num_files; i++, res++) {
-        int len = (file_lens[i] + 15) & ~0xf;
-
-        rc_name.offset = font_off >> 4;
-        rc_name.length = len >> 4;
-        rc_name.flags = 0xc00 | NE_SEGFLAGS_MOVEABLE | NE_SEGFLAGS_SHAREABLE | NE_SEGFLAGS_DISCARDABLE;
-        rc_name.id = res;
-        rc_name.handle = 0;
-        rc_name.usage = 0;
-        fwrite(&rc_name, sizeof(rc_name), 1, ofp);
-
-        font_off += len;
+    num_files = argc - 2;
+    fnts = calloc(num_files, sizeof(FntFile));
+    fonts = calloc(num_files, sizeof(FonFont));
+    fontoff = calloc(num_files, sizeof(long));
+    if(!fnts || !fonts || !fontoff) {
+        fprintf(stderr, "error: out of memory\n");
+        exit(1);
+    }
+    mark[0] = start;
+    mark[1] = cpuclock();
+    for(i = 0; i < num_files; i++) {
+        if(!loadfnt(files[i], &fnts[i]))
+            exit(1);
+        lap(mark, &fnts[i].wall[0], &fnts[i].cpu[0]);
+        fprintf(stderr, "%s %d pts %dx%d dpi\n", fnts[i].face, fnts[i].points, fnts[i].dpi[0], fnts[i].dpi[1]);
+        fonts[i].fnt = fnts[i].data;
+        fonts[i].size = fnts[i].size;
+        fonts[i].face = fnts[i].face;
     }
 
-    /* empty type info */
-    memset(&rc_type, 0, sizeof(rc_type));
-    fwrite(&rc_type, sizeof(rc_type), 1, ofp);
-
-    fputc(strlen("FONTDIR"), ofp);
-    fwrite("FONTDIR", strlen("FONTDIR"), 1, ofp);
-    fputc(strlen(resident_name), ofp);
-    fwrite(resident_name, strlen(resident_name), 1, ofp);
-
-    fputc(0x00, ofp);    fputc(0x00, ofp);
-    fputc(0x00, ofp);
-    fputc(0x00, ofp);    fputc(0x00, ofp);
-
-    fputc(strlen(non_resident_name), ofp);
-    fwrite(non_resident_name, strlen(non_resident_name), 1, ofp);
-    fputc(0x00, ofp); /* terminator */
-
-    /* empty ne_modtab and ne_imptab */
-    fputc(0x00, ofp);
-    fputc(0x00, ofp);
-
-    pad = ftell(ofp) & 0xf;
-    if(pad != 0)
-        pad = 0x10 - pad;
-    for(i = 0; i < pad; i++)
-        fputc(0x00, ofp);
-
-    /* FONTDIR resource */
-    fwrite(&num_files, sizeof(num_files), 1, ofp);
-
-    for(res = first_res, i = 0; i < num_files; i++, res++) {
-        fp = fopen(argv[i+1], "rb");
+    if((hdrsize = fonheader(fonts, num_files, NULL, fontoff, &total)) < 0) {
+        fprintf(stderr, hdrsize == -2 ? "error: fonts too large for one .fon\n" : "error: out of memory\n");
+        exit(1);
+    }
 
-        fwrite(&res, sizeof(res), 1, ofp);
-        fread(buf, 0x72, 1, fp);
+    output_file = argv[argc - 1];
+    if(cachedir) {
+        cacheinit(&key, "fnt2fon fon 2");  /* 2: .fon past 1MB */
+        for(i = 0; i < num_files; i++)
+            cachehash(&key, fnts[i].data, fnts[i].size);
+        if(cacheget(cachedir, &key, output_file)) {
+            fprintf(stderr, "cache: 1 hits, 0 misses\n");
+            if(stats) {
+                lap(mark, &header[0], &header[1]);
+                printstats(stderr, fnts, num_files, output_file, 0, 1, header, start);
+            }
+            return 0;
+        }
+    }
 
-        fnt_header = (FONTFILEHEADER *)buf;
-        fseek(fp, fnt_header->dffi.dfFace, SEEK_SET);
-        fnt_header->dffi.dfBitsOffset = 0;
-        fwrite(buf, 0x72, 1, ofp);
+    atexit( cleanup_files );
 
-        cp = name;
-        while((c = fgetc(fp)) != 0 && c != EOF)
-            *cp++ = c;
-        *cp = '\0';
-        fwrite(name, strlen(name) + 1, 1, ofp);
-        fclose(fp);
+    /* never write through a hard link into the cache */
+    unlink(output_file);
+    out = open(output_file, O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0666);
+    if(out < 0) {
+        fprintf(stderr, "error: unable to open %s for writing: %s\n", output_file, strerror(errno));
+        exit(1);
     }
 
-    pad = ftell(ofp) & 0xf;
-    if(pad != 0)
-        pad = 0x10 - pad;
-    for(i = 0; i < pad; i++)
-        fputc(0x00, ofp);
-
-    for(res = first_res, i = 0; i < num_files; i++, res++) {
-        fp = fopen(argv[i+1], "rb");
+    /* Presize the file: the padding between the pieces is the zeros this
+       leaves, the headers go into a map of the start, and the bodies are
+       copied to their offsets */
+#ifdef unix
+    if(ftruncate(out, total) != 0) {
+#else
+    if(chsize(out, total) != 0) {
+#endif
+        fprintf(stderr, "error: unable to write %s: %s\n", output_file, strerror(errno));
+        exit(1);
+    }
+#ifdef unix
+    hdr = mmap(NULL, hdrsize, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0);
+    if(hdr != MAP_FAILED) {
+        i = fonheader(fonts, num_files, hdr, fontoff, &total) < 0;
+        munmap(hdr, hdrsize);
+    } else
+#endif
+    {
+        if(!(hdr = calloc(hdrsize, 1)) || fonheader(fonts, num_files, hdr, fontoff, &total) < 0) {
+            fprintf(stderr, "error: out of memory\n");
+            exit(1);
+        }
+        i = !writeat(out, hdr, hdrsize, 0);
+        free(hdr);
+    }
+    if(i) {
+        fprintf(stderr, "error: unable to write %s: %s\n", output_file, strerror(errno));
+        exit(1);
+    }
+    lap(mark, &header[0], &header[1]);
 
-        while(1) {
-            nread = read(fileno(fp), buf, sizeof(buf));
-            if(!nread) break;
-            fwrite(buf, nread, 1, ofp);
+    for(i = 0; i < num_files; i++) {
+        if(!copybody(out, &fnts[i], fontoff[i])) {
+            fprintf(stderr, "error: unable to write %s: %s\n", output_file, strerror(errno));
+            exit(1);
         }
-        fclose(fp);
-        pad = file_lens[i] & 0xf;
-        if(pad != 0)
-            pad = 0x10 - pad;
-        for(j = 0; j < pad; j++)
-            fputc(0x00, ofp);
+        lap(mark, &fnts[i].wall[1], &fnts[i].cpu[1]);
+    }
+    if(close(out) != 0) {
+        fprintf(stderr, "error: unable to write %s: %s\n", output_file, strerror(errno));
+        exit(1);
+    }
+    if(cachedir) {
+        cacheputfile(cachedir, &key, output_file);
+        fprintf(stderr, "cache: 0 hits, 1 misses\n");
     }
-    fclose(ofp);
+    if(stats)
+        printstats(stderr, fnts, num_files, output_file, total, 0, header, start);
     output_file = NULL;
 
+    for(i = 0; i < num_files; i++)
+        freefnt(&fnts[i]);
+    free(fontoff);
+    free(fonts);
+    free(fnts);
     return 0;
 }
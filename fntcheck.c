@@ -0,0 +1,540 @@
+/*
+ * fntcheck.c - structural check of .fnt and .fon files before they ship.
+ * Each file is mapped and its headers, resource table, FONTDIR and glyph
+ * tables are walked once; the first inconsistency is reported with its
+ * byte offset in the file.  Files are checked in parallel.
+ *
+ * Released under the terms of GNU General Public License
+ * (GPL) version 2 (See: http://www.fsf.org/licenses/gpl.html)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef unix
+#include <unistd.h>
+#include <sys/mman.h>
+#else
+#include <io.h>
+#endif
+#include <pthread.h>
+#include "fontstruc.h"
+#include "fon.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define FNT2_HEADER offsetof(FONTFILEHEADER, dffi.dfFlags)
+#define FNT3_HEADER sizeof(FONTFILEHEADER)
+#define FNT_FIELD(f) offsetof(FONTFILEHEADER, f)
+
+static char *program ;
+
+static void usage(void)
+{
+  fprintf(stderr,
+    "Usage: fntcheck [-v] [-j jobs] [file...]\n"
+    "\n"
+    "Check the structure of .fnt and .fon files; with no files, read their\n"
+    "names from stdin, one per line.\n"
+    "\n"
+    "Options:\n"
+    " -v\t\tAlso print the files that pass\n"
+    " -j jobs\tNumber of files to check in parallel (default: one per CPU)\n"
+    "\n"
+    "Each bad file is printed with the byte offset of its first problem.\n"
+    "The exit status is 1 if any file is bad.\n");
+  exit(1);
+}
+
+static void *xalloc(size_t n, size_t size)
+{
+  void *p = calloc(n ? n : 1, size) ;
+
+  if ( p == NULL ) {
+    fprintf(stderr, "%s: out of memory\n", program) ;
+    exit(1) ;
+  }
+  return p ;
+}
+
+/* One file to check, and what was found */
+typedef struct {
+  const char *path ;
+  long offset ;                 /* of the first problem, or -1 */
+  char problem[128] ;
+} Check ;
+
+/* Record the first problem; always returns 0 so callers can return it */
+static int bad(Check *ck, long offset, const char *fmt, ...)
+{
+  va_list ap ;
+
+  if ( ck->offset < 0 ) {
+    ck->offset = offset ;
+    va_start(ap, fmt) ;
+    vsnprintf(ck->problem, sizeof(ck->problem), fmt, ap) ;
+    va_end(ap) ;
+  }
+  return 0 ;
+}
+
+static unsigned get16(const unsigned char *p)
+{
+  return p[0] | p[1] << 8 ;
+}
+
+static unsigned long get32(const unsigned char *p)
+{
+  return get16(p) | (unsigned long)get16(p + 2) << 16 ;
+}
+
+/* A .fnt image of len bytes at file offset base.  In a .fon, len is the
+   size of its resource, which may be padded past dfSize. */
+static int checkfnt(Check *ck, const unsigned char *fnt, long len, long base,
+                    int standalone)
+{
+  FONTFILEHEADER hdr ;
+  long hdrsz, entsz, size, tabend, bits, face, i, n ;
+  int h ;
+
+  if ( len < (long)FNT2_HEADER )
+    return bad(ck, base, "%ld bytes is too short for a .fnt header", len) ;
+  memset(&hdr, 0, sizeof(hdr)) ;
+  memcpy(&hdr, fnt, len < (long)sizeof(hdr) ? len : (long)sizeof(hdr)) ;
+
+  switch ( (unsigned short)hdr.dfVersion ) {
+  case 0x200:
+    hdrsz = FNT2_HEADER ;
+    entsz = sizeof(RASTERGLYPHENTRY) ;
+    break ;
+  case 0x300:
+    hdrsz = FNT3_HEADER ;
+    entsz = sizeof(RASTERGLYPHENTRY3) ;
+    if ( len < hdrsz )
+      return bad(ck, base, "%ld bytes is too short for a 3.x .fnt header", len) ;
+    break ;
+  default:
+    return bad(ck, base + FNT_FIELD(dfVersion), "unknown .fnt version 0x%x",
+               (unsigned short)hdr.dfVersion) ;
+  }
+
+  size = (unsigned long)hdr.dfSize ;
+  if ( size < hdrsz || size > len )
+    return bad(ck, base + FNT_FIELD(dfSize), "dfSize %ld is outside %ld..%ld",
+               size, hdrsz, len) ;
+  if ( standalone && size != len )
+    return bad(ck, base + FNT_FIELD(dfSize), "dfSize %ld but the file is %ld bytes",
+               size, len) ;
+  if ( hdr.dffi.dfType & PF_VECTOR_TYPE )
+    return bad(ck, base + FNT_FIELD(dffi.dfType), "vector font, not a raster one") ;
+  if ( (h = hdr.dffi.dfPixHeight) <= 0 )
+    return bad(ck, base + FNT_FIELD(dffi.dfPixHeight), "dfPixHeight %d", h) ;
+  if ( hdr.dffi.dfFirstChar > hdr.dffi.dfLastChar )
+    return bad(ck, base + FNT_FIELD(dffi.dfFirstChar), "dfFirstChar %d after dfLastChar %d",
+               hdr.dffi.dfFirstChar, hdr.dffi.dfLastChar) ;
+  n = hdr.dffi.dfLastChar - hdr.dffi.dfFirstChar + 1 ;
+  if ( hdr.dffi.dfDefaultChar >= n )
+    return bad(ck, base + FNT_FIELD(dffi.dfDefaultChar), "dfDefaultChar %d past the last glyph",
+               hdr.dffi.dfDefaultChar) ;
+  if ( hdr.dffi.dfBreakChar >= n )
+    return bad(ck, base + FNT_FIELD(dffi.dfBreakChar), "dfBreakChar %d past the last glyph",
+               hdr.dffi.dfBreakChar) ;
+
+  /* glyph table: one entry per character and a sentinel */
+  tabend = hdrsz + (n + 1) * entsz ;
+  if ( tabend > size )
+    return bad(ck, base + hdrsz, "glyph table of %ld entries runs past dfSize %ld",
+               n + 1, size) ;
+  bits = (unsigned long)hdr.dffi.dfBitsOffset ;
+  if ( bits < tabend || bits > size )
+    return bad(ck, base + FNT_FIELD(dffi.dfBitsOffset), "dfBitsOffset %ld is outside %ld..%ld",
+               bits, tabend, size) ;
+  face = (unsigned long)hdr.dffi.dfFace ;
+  if ( face < tabend || face >= size )
+    return bad(ck, base + FNT_FIELD(dffi.dfFace), "dfFace %ld is outside %ld..%ld",
+               face, tabend, size - 1) ;
+  if ( memchr(fnt + face, 0, size - face) == NULL )
+    return bad(ck, base + face, "face name runs past dfSize") ;
+  if ( hdr.dfVersion == 0x200 && face > 0x10000 )
+    return bad(ck, base + FNT_FIELD(dfVersion),
+               "2.x glyph offsets cannot reach rasters ending at %ld", face) ;
+
+  for ( i = 0 ; i <= n ; i++ ) {
+    const unsigned char *e = fnt + hdrsz + i * entsz ;
+    long w = (short)get16(e) ;
+    long off = entsz == 4 ? (long)get16(e + 2) : (long)get32(e + 2) ;
+
+    if ( w < 0 )
+      return bad(ck, base + hdrsz + i * entsz, "glyph %ld has width %ld", i, w) ;
+    if ( w == 0 && off == 0 )   /* gap or sentinel */
+      continue ;
+    if ( w > hdr.dffi.dfMaxWidth )
+      return bad(ck, base + hdrsz + i * entsz, "glyph %ld is %ld wide, dfMaxWidth %d",
+                 i, w, hdr.dffi.dfMaxWidth) ;
+    if ( off < bits || off + (w + 7) / 8 * h > size )
+      return bad(ck, base + hdrsz + i * entsz + 2,
+                 "glyph %ld raster %ld..%ld is outside %ld..%ld",
+                 i, off, off + (w + 7) / 8 * h, bits, size) ;
+  }
+  return 1 ;
+}
+
+/* One FONT resource of a .fon */
+typedef struct {
+  unsigned id ;
+  long offset, length ;         /* in the file */
+} FonRes ;
+
+static int checkfon(Check *ck, const unsigned char *fon, long len)
+{
+  IMAGE_OS2_HEADER ne ;
+  long neoff, rsrc, q, dir = -1, dirlen = 0, p, end ;
+  FonRes *res = NULL ;
+  int nres = 0, maxres = 0, align, i, j, ok = 0 ;
+  unsigned n ;
+
+  if ( len < (long)sizeof(IMAGE_DOS_HEADER) )
+    return bad(ck, 0, "%ld bytes is too short for an MZ header", len) ;
+  neoff = get32(fon + offsetof(IMAGE_DOS_HEADER, e_lfanew)) ;
+  if ( neoff < (long)sizeof(IMAGE_DOS_HEADER) || neoff + (long)sizeof(ne) > len )
+    return bad(ck, offsetof(IMAGE_DOS_HEADER, e_lfanew), "NE header offset %ld is outside the file",
+               neoff) ;
+  memcpy(&ne, fon + neoff, sizeof(ne)) ;
+  if ( ne.ne_magic != 0x454e )
+    return bad(ck, neoff, "no NE signature") ;
+
+  /* resource table: shift count, then type blocks up to a zero type */
+  rsrc = neoff + ne.ne_rsrctab ;
+  if ( rsrc + 2 > len )
+    return bad(ck, neoff + offsetof(IMAGE_OS2_HEADER, ne_rsrctab),
+               "resource table offset %ld is outside the file", rsrc) ;
+  if ( (align = get16(fon + rsrc)) > 15 )
+    return bad(ck, rsrc, "resource alignment shift %d", align) ;
+  for ( q = rsrc + 2 ; ; ) {
+    unsigned type, count ;
+
+    if ( q + 2 > len )
+      goto fail_table ;
+    if ( (type = get16(fon + q)) == 0 )
+      break ;
+    if ( q + (long)sizeof(NE_TYPEINFO) > len )
+      goto fail_table ;
+    count = get16(fon + q + offsetof(NE_TYPEINFO, count)) ;
+    if ( type == NE_RSCTYPE_FONTDIR && (count != 1 || dir >= 0) ) {
+      bad(ck, q, "%u FONTDIR resources", dir >= 0 ? count + 1 : count) ;
+      goto done ;
+    }
+    if ( type == NE_RSCTYPE_FONT && nres > 0 ) {
+      bad(ck, q, "second block of FONT resources") ;
+      goto done ;
+    }
+    q += sizeof(NE_TYPEINFO) ;
+    if ( q + (long)count * (long)sizeof(NE_NAMEINFO) > len )
+      goto fail_table ;
+    if ( type == NE_RSCTYPE_FONT )
+      res = (FonRes *)xalloc(maxres = count, sizeof(FonRes)) ;
+    for ( ; count > 0 ; count--, q += sizeof(NE_NAMEINFO) ) {
+      NE_NAMEINFO ni ;
+      long start, size ;
+
+      memcpy(&ni, fon + q, sizeof(ni)) ;
+      start = (long)ni.offset << align ;
+      size = (long)ni.length << align ;
+      if ( start + size > len ) {
+        bad(ck, q, "resource %ld..%ld is outside the file", start, start + size) ;
+        goto done ;
+      }
+      if ( type == NE_RSCTYPE_FONTDIR ) {
+        dir = start ;
+        dirlen = size ;
+      } else if ( type == NE_RSCTYPE_FONT && nres < maxres ) {
+        res[nres].id = ni.id & 0x7fff ;
+        res[nres].offset = start ;
+        res[nres].length = size ;
+        nres++ ;
+      }
+    }
+  }
+  if ( dir < 0 ) {
+    bad(ck, rsrc, "no FONTDIR resource") ;
+    goto done ;
+  }
+  if ( nres == 0 ) {
+    bad(ck, rsrc, "no FONT resources") ;
+    goto done ;
+  }
+
+  /* resident names, each length-prefixed, up to a zero length */
+  for ( p = neoff + ne.ne_restab ; p < len && fon[p] ; p += fon[p] + 3 ) ;
+  if ( p >= len ) {
+    bad(ck, neoff + offsetof(IMAGE_OS2_HEADER, ne_restab), "resident name table runs past the end") ;
+    goto done ;
+  }
+  if ( (unsigned long)ne.ne_nrestab + ne.ne_cbnrestab > (unsigned long)len ) {
+    bad(ck, neoff + offsetof(IMAGE_OS2_HEADER, ne_nrestab),
+        "non-resident name table runs past the end") ;
+    goto done ;
+  }
+
+  /* FONTDIR: a count, then per font its ordinal, header and face name */
+  end = dir + dirlen ;
+  if ( dir + 2 > end || (n = get16(fon + dir)) != (unsigned)nres ) {
+    bad(ck, dir, "FONTDIR lists %u fonts, the resource table %d", dir + 2 > end ? 0 : n, nres) ;
+    goto done ;
+  }
+  for ( p = dir + 2, i = 0 ; i < nres ; i++ ) {
+    const FonRes *r ;
+    const unsigned char *fnt, *dirface, *face ;
+    long faceoff ;
+
+    if ( p + 2 + FON_FNTHDR > end ) {
+      bad(ck, p, "FONTDIR entry %d runs past the resource", i) ;
+      goto done ;
+    }
+    for ( j = 0 ; j < nres && res[(i + j) % nres].id != get16(fon + p) ; j++ ) ;
+    if ( j == nres ) {
+      bad(ck, p, "FONTDIR entry %d names font %u, which is not a resource", i, get16(fon + p)) ;
+      goto done ;
+    }
+    r = &res[(i + j) % nres] ;
+    dirface = fon + p + 2 + FON_FNTHDR ;
+    if ( memchr(dirface, 0, fon + end - dirface) == NULL ) {
+      bad(ck, p + 2 + FON_FNTHDR, "FONTDIR entry %d face name runs past the resource", i) ;
+      goto done ;
+    }
+    if ( ! checkfnt(ck, fon + r->offset, r->length, r->offset, 0) )
+      goto done ;
+
+    /* the entry repeats the font's header up to dfBitsOffset */
+    fnt = fon + r->offset ;
+    if ( memcmp(fon + p + 2, fnt, FNT_FIELD(dffi.dfBitsOffset)) != 0 ) {
+      bad(ck, p + 2, "FONTDIR entry %d header differs from font %u", i, r->id) ;
+      goto done ;
+    }
+    faceoff = get32(fnt + FNT_FIELD(dffi.dfFace)) ;
+    face = fnt + faceoff ;
+    if ( strcmp((const char *)dirface, (const char *)face) != 0 ) {
+      bad(ck, p + 2 + FON_FNTHDR, "FONTDIR entry %d face \"%s\" but font %u is \"%s\"",
+          i, dirface, r->id, face) ;
+      goto done ;
+    }
+    p = dirface - fon + strlen((const char *)dirface) + 1 ;
+  }
+  ok = 1 ;
+  goto done ;
+
+fail_table:
+  bad(ck, q, "resource table runs past the end") ;
+done:
+  free(res) ;
+  return ok ;
+}
+
+/* Map the file, or read it if it can't be mapped, and check it */
+static int checkfile(Check *ck)
+{
+  unsigned char *data = NULL ;
+  long len = 0 ;
+  int fd, mapped = 0, ok ;
+  struct stat st ;
+
+  ck->offset = -1 ;
+  if ( (fd = open(ck->path, O_RDONLY | O_BINARY)) < 0 || fstat(fd, &st) != 0 ) {
+    snprintf(ck->problem, sizeof(ck->problem), "%s", strerror(errno)) ;
+    if ( fd >= 0 )
+      close(fd) ;
+    return 0 ;
+  }
+  len = st.st_size ;
+#ifdef unix
+  if ( len > 0 ) {
+    data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0) ;
+    if ( data == MAP_FAILED )
+      data = NULL ;
+    else
+      mapped = 1 ;
+  }
+#endif
+  if ( data == NULL ) {
+    long done = 0 ;
+    ssize_t got = 1 ;
+
+    data = (unsigned char *)xalloc(len, 1) ;
+    while ( done < len && (got = read(fd, data + done, len - done)) != 0 ) {
+      if ( got < 0 && errno != EINTR )
+        break ;
+      if ( got > 0 )
+        done += got ;
+    }
+    if ( done < len ) {
+      snprintf(ck->problem, sizeof(ck->problem), "%s", got < 0 ? strerror(errno) : "short read") ;
+      free(data) ;
+      close(fd) ;
+      return 0 ;
+    }
+  }
+  close(fd) ;
+
+  if ( len >= 2 && data[0] == 'M' && data[1] == 'Z' )
+    ok = checkfon(ck, data, len) ;
+  else
+    ok = checkfnt(ck, data, len, 0, 1) ;
+
+#ifdef unix
+  if ( mapped )
+    munmap(data, len) ;
+  else
+#endif
+    free(data) ;
+  return ok ;
+}
+
+typedef struct {
+  Check *checks ;
+  int nchecks ;
+  int next ;
+  int failed ;
+  pthread_mutex_t lock ;
+} Batch ;
+
+static void *worker(void *arg)
+{
+  Batch *batch = (Batch *)arg ;
+
+  for (;;) {
+    int index, ok ;
+
+    pthread_mutex_lock(&batch->lock) ;
+    index = batch->next < batch->nchecks ? batch->next++ : -1 ;
+    pthread_mutex_unlock(&batch->lock) ;
+    if ( index < 0 )
+      break ;
+
+    ok = checkfile(&batch->checks[index]) ;
+
+    if ( ! ok ) {
+      pthread_mutex_lock(&batch->lock) ;
+      batch->failed++ ;
+      pthread_mutex_unlock(&batch->lock) ;
+    }
+  }
+  return NULL ;
+}
+
+/* Check all files on a pool of nworkers threads; returns number of failures */
+static int runbatch(Check *checks, int nchecks, int nworkers)
+{
+  Batch batch ;
+  pthread_t *threads ;
+  int i, started ;
+
+  if ( nworkers <= 0 ) {
+#ifdef _SC_NPROCESSORS_ONLN
+    nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN) ;
+#endif
+    if ( nworkers <= 0 )
+      nworkers = 1 ;
+  }
+  if ( nworkers > nchecks )
+    nworkers = nchecks ;
+
+  batch.checks = checks ;
+  batch.nchecks = nchecks ;
+  batch.next = 0 ;
+  batch.failed = 0 ;
+  pthread_mutex_init(&batch.lock, NULL) ;
+
+  threads = (pthread_t *)xalloc(nworkers, sizeof(pthread_t)) ;
+  for ( started = 0 ; started < nworkers ; started++ )
+    if ( pthread_create(&threads[started], NULL, worker, &batch) != 0 )
+      break ;
+  if ( started == 0 )           /* no threads available, run inline */
+    worker(&batch) ;
+  for ( i = 0 ; i < started ; i++ )
+    pthread_join(threads[i], NULL) ;
+
+  pthread_mutex_destroy(&batch.lock) ;
+  free(threads) ;
+  return batch.failed ;
+}
+
+/* File names from stdin, one per line */
+static Check *readnames(FILE *in, int *nchecks)
+{
+  char line[4096] ;
+  int max = 64 ;
+  Check *checks = (Check *)xalloc(max, sizeof(Check)) ;
+
+  *nchecks = 0 ;
+  while ( fgets(line, sizeof(line), in) ) {
+    size_t len = strcspn(line, "\r\n") ;
+
+    if ( len == 0 )
+      continue ;
+    line[len] = '\0' ;
+    if ( *nchecks == max ) {
+      checks = (Check *)realloc(checks, (max *= 2) * sizeof(Check)) ;
+      if ( checks == NULL ) {
+        fprintf(stderr, "%s: out of memory\n", program) ;
+        exit(1) ;
+      }
+    }
+    checks[*nchecks].path = strdup(line) ;
+    (*nchecks)++ ;
+  }
+  return checks ;
+}
+
+int main(int argc, char *argv[])
+{
+  Check *checks ;
+  int nchecks = 0, nworkers = 0, verbose = 0, failed, i ;
+
+  for ( program = *argv++ ; --argc && argv[0][0] == '-' && argv[0][1] ; argv++ ) {
+    switch ( argv[0][1] ) {
+    case 'v':
+      verbose = 1 ;
+      break ;
+    case 'j':
+      if ( ! --argc )
+        usage() ;
+      if ( (nworkers = atoi(*++argv)) <= 0 )
+        usage() ;
+      break ;
+    default:
+      usage() ;
+    }
+  }
+
+  if ( argc > 0 ) {
+    checks = (Check *)xalloc(argc, sizeof(Check)) ;
+    for ( i = 0 ; i < argc ; i++ )
+      checks[nchecks++].path = argv[i] ;
+  } else
+    checks = readnames(stdin, &nchecks) ;
+  if ( nchecks == 0 )
+    return 0 ;
+
+  failed = runbatch(checks, nchecks, nworkers) ;
+
+  /* report in the order given, whatever order the workers finished in */
+  for ( i = 0 ; i < nchecks ; i++ ) {
+    if ( checks[i].problem[0] == '\0' ) {
+      if ( verbose )
+        printf("%s: ok\n", checks[i].path) ;
+    } else if ( checks[i].offset < 0 )
+      printf("%s: %s\n", checks[i].path, checks[i].problem) ;
+    else
+      printf("%s: offset 0x%lx: %s\n", checks[i].path, checks[i].offset,
+             checks[i].problem) ;
+  }
+  return failed ? 1 : 0 ;
+}
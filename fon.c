@@ -0,0 +1,251 @@
+/*
+ * fon.c.  Lay out a .fon file around a set of .fnt images
+ *
+ * Copyright 2004 Huw Davies
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fontstruc.h"
+#include "fon.h"
+
+static const BYTE MZ_hdr[] = {
+    'M',  'Z',  0x0d, 0x01, 0x01, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00,
+    0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
+    0x0e, 0x1f, 0xba, 0x0e, 0x00, 0xb4, 0x09, 0xcd, 0x21, 0xb8, 0x01, 0x4c, 0xcd, 0x21, 'T',  'h',
+    'i',  's',  ' ',  'P',  'r',  'o',  'g',  'r',  'a',  'm',  ' ',  'c',  'a',  'n',  'n',  'o',
+    't',  ' ',  'b',  'e',  ' ',  'r',  'u',  'n',  ' ',  'i',  'n',  ' ',  'D',  'O',  'S',  ' ',
+    'm',  'o',  'd',  'e',  0x0d, 0x0a, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+#define PADSHIFT(x, shift) (((x) + (1L << (shift)) - 1) & -(1L << (shift)))
+
+static unsigned char *put(unsigned char *p, const void *data, size_t len)
+{
+    memcpy(p, data, len);
+    return p + len;
+}
+
+/* length byte followed by the string */
+static unsigned char *putname(unsigned char *p, const char *name)
+{
+    size_t len = strlen(name);
+
+    *p++ = (unsigned char)len;
+    return put(p, name, len);
+}
+
+long fonheader(const FonFont *fonts, int nfonts, unsigned char *hdr,
+               long *fontoff, long *total)
+{
+    int i;
+    FONTFILEHEADER fnt_header;
+    short pt = 0, dpi[2] = { 0, 0 }, align, num_files = nfonts;
+    int resource_table_len, non_resident_name_len, resident_name_len;
+    unsigned short resource_table_off, resident_name_off, module_ref_off, non_resident_name_off;
+    long fontdir_off, font_off, hdrsize;
+    const char *resident_name = nfonts > 0 ? fonts[0].face : "";
+    int fontdir_len = 2;
+    char *non_resident_name;
+    unsigned short first_res = 0x0050, res;
+    unsigned char *p;
+    IMAGE_OS2_HEADER NE_hdr;
+    NE_TYPEINFO rc_type;
+    NE_NAMEINFO rc_name;
+
+    non_resident_name = malloc(80 + strlen(resident_name) + 8 * nfonts);
+    if(!non_resident_name)
+        return -1;
+    non_resident_name[0] = '\0';
+    for(i = 0; i < nfonts; i++) {
+        memcpy(&fnt_header, fonts[i].fnt, FON_FNTHDR);
+        pt = fnt_header.dffi.dfPoints;
+        dpi[0] = fnt_header.dffi.dfVertRes;
+        dpi[1] = fnt_header.dffi.dfHorizRes;
+        /* fontdir entries for version 3 fonts are the same as for version 2 */
+        fontdir_len += 0x74 + strlen(fonts[i].face) + 1;
+        if(i == 0)
+            sprintf(non_resident_name, "FONTRES 100,%d,%d : %.160s %d", dpi[0], dpi[1], resident_name, pt);
+        else
+            sprintf(non_resident_name + strlen(non_resident_name), ",%d", pt);
+    }
+    if(dpi[0] <= 108)
+        strcat(non_resident_name, " (VGA res)");
+    else
+        strcat(non_resident_name, " (8514 res)");
+    non_resident_name_len = strlen(non_resident_name) + 4;
+
+    /* shift count + fontdir entry + num_files of font + nul type + \007FONTDIR */
+    resource_table_len = sizeof(align) + sizeof("FONTDIR") +
+                         sizeof(NE_TYPEINFO) + sizeof(NE_NAMEINFO) +
+                         sizeof(NE_TYPEINFO) + sizeof(NE_NAMEINFO) * num_files +
+                         sizeof(NE_TYPEINFO);
+    resource_table_off = sizeof(NE_hdr);
+    resident_name_off = resource_table_off + resource_table_len;
+    resident_name_len = strlen(resident_name) + 4;
+    module_ref_off = resident_name_off + resident_name_len;
+    non_resident_name_off = sizeof(MZ_hdr) + module_ref_off + sizeof(align);
+
+    memset(&NE_hdr, 0, sizeof(NE_hdr));
+    NE_hdr.ne_magic = 0x454e;
+    NE_hdr.ne_ver = 5;
+    NE_hdr.ne_rev = 1;
+    NE_hdr.ne_flags = NE_FFLAGS_LIBMODULE | NE_FFLAGS_GUI;
+    NE_hdr.ne_cbnrestab = non_resident_name_len;
+    NE_hdr.ne_segtab = sizeof(NE_hdr);
+    NE_hdr.ne_rsrctab = sizeof(NE_hdr);
+    NE_hdr.ne_restab = resident_name_off;
+    NE_hdr.ne_modtab = module_ref_off;
+    NE_hdr.ne_imptab = module_ref_off;
+    NE_hdr.ne_enttab = NE_hdr.ne_modtab;
+    NE_hdr.ne_nrestab = non_resident_name_off;
+    NE_hdr.ne_exetyp = 2;//NE_OSFLAGS_WINDOWS;
+    NE_hdr.ne_expver = 0x400;
+
+    /* Resource offsets and lengths are 16-bit counts of 1 << align bytes:
+       the usual 16 byte units reach 1MB, so bigger files take the
+       smallest shift that reaches their end. */
+    for(align = 4; ; align++) {
+        fontdir_off = PADSHIFT(non_resident_name_off + non_resident_name_len, align);
+        font_off = PADSHIFT(fontdir_off + fontdir_len, align);
+        hdrsize = font_off;
+
+        for(i = 0; i < num_files; i++) {
+            fontoff[i] = font_off;
+            font_off += PADSHIFT(fonts[i].size, align);
+        }
+        if((font_off >> align) <= 0xffff)
+            break;
+        if(align == 15) {
+            free(non_resident_name);
+            return -2;
+        }
+    }
+    *total = font_off;
+    NE_hdr.ne_align = align;
+
+    if(!hdr) {
+        free(non_resident_name);
+        return hdrsize;
+    }
+
+    p = put(hdr, MZ_hdr, sizeof(MZ_hdr));
+    p = put(p, &NE_hdr, sizeof(NE_hdr));
+
+    p = put(p, &align, sizeof(align));
+
+    rc_type.type_id = NE_RSCTYPE_FONTDIR;
+    rc_type.count = 1;
+    rc_type.resloader = 0;
+    p = put(p, &rc_type, sizeof(rc_type));
+
+    rc_name.offset = fontdir_off >> align;
+    rc_name.length = PADSHIFT(fontdir_len, align) >> align;
+    rc_name.flags = 0xc00 | NE_SEGFLAGS_MOVEABLE | NE_SEGFLAGS_PRELOAD;
+    rc_name.id = resident_name_off - sizeof("FONTDIR") - NE_hdr.ne_rsrctab;
+    rc_name.handle = 0;
+    rc_name.usage = 0;
+    p = put(p, &rc_name, sizeof(rc_name));
+
+    rc_type.type_id = NE_RSCTYPE_FONT;
+    rc_type.count = num_files;
+    rc_type.resloader = 0;
+    p = put(p, &rc_type, sizeof(rc_type));
+
+    for(res = first_res | 0x8000, i = 0; i < num_files; i++, res++) {
+        rc_name.offset = fontoff[i] >> align;
+        rc_name.length = PADSHIFT(fonts[i].size, align) >> align;
+        rc_name.flags = 0xc00 | NE_SEGFLAGS_MOVEABLE | NE_SEGFLAGS_SHAREABLE | NE_SEGFLAGS_DISCARDABLE;
+        rc_name.id = res;
+        rc_name.handle = 0;
+        rc_name.usage = 0;
+        p = put(p, &rc_name, sizeof(rc_name));
+    }
+
+    /* empty type info */
+    memset(&rc_type, 0, sizeof(rc_type));
+    p = put(p, &rc_type, sizeof(rc_type));
+
+    p = putname(p, "FONTDIR");
+    p = putname(p, resident_name);
+
+    p += 5;                     /* zero ordinal and terminators */
+
+    p = putname(p, non_resident_name);
+    p++;                        /* terminator */
+
+    /* empty ne_modtab and ne_imptab */
+    p += 2;
+
+    /* FONTDIR resource */
+    p = hdr + fontdir_off;
+    p = put(p, &num_files, sizeof(num_files));
+
+    for(res = first_res, i = 0; i < num_files; i++, res++) {
+        p = put(p, &res, sizeof(res));
+        memcpy(&fnt_header, fonts[i].fnt, FON_FNTHDR);
+        fnt_header.dffi.dfBitsOffset = 0;
+        p = put(p, &fnt_header, FON_FNTHDR);
+        p = put(p, fonts[i].face, strlen(fonts[i].face) + 1);
+    }
+
+    free(non_resident_name);
+    return hdrsize;
+}
+
+unsigned char *buildfon(const FonFont *fonts, int nfonts, unsigned char *buf,
+                        long *size)
+{
+    long total, hdrsize, *fontoff;
+    unsigned char *fon = NULL;
+    int i;
+
+    if(!(fontoff = malloc((nfonts + 1) * sizeof(long)))) {
+        *size = 0;
+        return NULL;
+    }
+    if((hdrsize = fonheader(fonts, nfonts, NULL, fontoff, &total)) < 0) {
+        free(fontoff);
+        *size = hdrsize == -2 ? -1 : 0;
+        return NULL;
+    }
+    if(buf && *size < total) {
+        free(fontoff);
+        *size = total;
+        return NULL;
+    }
+    if((fon = buf) != NULL)
+        memset(fon, 0, total);
+    else
+        fon = calloc(total, 1);
+
+    if(fon && fonheader(fonts, nfonts, fon, fontoff, &total) >= 0) {
+        for(i = 0; i < nfonts; i++)
+            memcpy(fon + fontoff[i], fonts[i].fnt, fonts[i].size);
+    } else {
+        if(fon != buf)
+            free(fon);
+        fon = NULL;
+        total = 0;
+    }
+    free(fontoff);
+    *size = total;
+    return fon;
+}
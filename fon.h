@@ -0,0 +1,48 @@
+/*
+ * fon.h.  Lay out a .fon file around a set of .fnt images
+ *
+ * Copyright 2004 Huw Davies
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Bytes of each .fnt header that go into its FONTDIR entry */
+#define FON_FNTHDR 0x72
+
+/* One font going into the .fon.  fonheader() only needs the first
+   FON_FNTHDR bytes of the .fnt; buildfon() needs the whole image. */
+typedef struct {
+    const unsigned char *fnt;   /* .fnt image, starting with its header */
+    long size;                  /* size of the whole .fnt */
+    const char *face;           /* face name */
+} FonFont;
+
+/* MZ/NE headers, resource tables and FONTDIR for the fonts, up to where
+   the first font starts.  The fonts follow one another, each padded with
+   zeros to the resource alignment: 16 bytes, or more for a .fon past 1MB;
+   fontoff[i] gets the file offset of font i and *total the size of the
+   whole .fon.  Returns the header size, -1 if out of memory, or -2 if the
+   fonts are too large for one .fon (past 2GB).  With hdr NULL it only works out the layout; else hdr
+   must hold that many zeroed bytes, and the headers are filled in. */
+long fonheader(const FonFont *fonts, int nfonts, unsigned char *hdr,
+               long *fontoff, long *total);
+
+/* The whole .fon, in buf if that is not NULL, else in one malloc'ed
+   buffer; *size is the room in buf on entry and the .fon size on return.
+   Returns NULL if buf is too small, with *size set to the room needed, if
+   out of memory, with *size set to 0, or if the fonts are too large for a
+   .fon, with *size set to -1. */
+unsigned char *buildfon(const FonFont *fonts, int nfonts, unsigned char *buf,
+                        long *size);
@@ -5,8 +5,9 @@
 typedef unsigned char CHAR;
 typedef unsigned char BYTE;
 typedef unsigned short WORD;
-typedef unsigned long DWORD;
-typedef long LONG;
+/* 32 bits, as in the file formats, also on LP64 hosts */
+typedef unsigned int DWORD;
+typedef int LONG;
 typedef short SHORT;
 typedef short INT16;
 typedef WORD HANDLE16;
@@ -203,7 +204,7 @@ typedef struct tagVECTORGLYPHENTRY {
 
 typedef struct tagFONTFILEHEADER {
     short dfVersion;
-    long  dfSize;
+    LONG  dfSize;
     char  dfCopyright[60];
     FONTINFO dffi;
 } FONTFILEHEADER;
@@ -215,7 +216,7 @@ typedef struct tabRASTERGLYPHENTRY {
 
 typedef struct tabRASTERGLYPHENTRY3 {
   short rgeWidth;
-  long rgeOffset;
+  LONG rgeOffset;
 } RASTERGLYPHENTRY3 ;
 
 #pragma pack(pop)
@@ -227,6 +228,11 @@ typedef struct tabRASTERGLYPHENTRY3 {
 
 #define DF_CHARSET_ANSI 0
 #define DF_CHARSET_SYMBOL 2
+#define DF_CHARSET_GREEK 161
+#define DF_CHARSET_TURKISH 162
+#define DF_CHARSET_BALTIC 186
+#define DF_CHARSET_RUSSIAN 204
+#define DF_CHARSET_EASTEUROPE 238
 #define DF_CHARSET_OEM 255
 
 #define FF_VARIABLE 0x01
@@ -0,0 +1,581 @@
+/*
+ * serve.c - bdf2fnt as a long-running converter on a Unix domain socket
+ * (see serve.h for the protocol).  Each worker thread keeps its output
+ * buffers and the arena of the last font it parsed, and each connection
+ * its input buffer, from one request to the next.
+ *
+ * Released under the terms of GNU General Public License
+ * (GPL) version 2 (See: http://www.fsf.org/licenses/gpl.html)
+ */
+
+#define _GNU_SOURCE             /* accept4 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include "bdf2fon.h"
+#include "serve.h"
+
+#define MAX_HEADER 1024
+#define SEND_TIMEOUT 10000      /* ms a reply waits for a client to read */
+#define KEEP_PAYLOAD (1L << 20) /* payload buffer a connection keeps idle */
+
+typedef struct {
+  int fon ;                     /* fon request, else fnt */
+  Bdf2fonOptions options ;
+  int scale ;
+  int subset ;                  /* --chars given */
+  unsigned char chars[BDF2FON_CHARSETSIZE] ;
+  int nparts ;
+  size_t sizes[SERVE_MAXPARTS] ;
+  size_t total ;
+  char name[MAX_HEADER] ;
+} Request ;
+
+/* One nonblocking connection, read as far as it has sent: its header
+   line, then the payload that header announced.  Whichever worker gets
+   its next event carries on from here. */
+typedef struct {
+  int fd ;
+  int payload ;                 /* header read, now reading rq.total bytes */
+  size_t hlen ;
+  char header[MAX_HEADER] ;
+  Request rq ;
+  char *data ;                  /* the payload, have bytes of it so far */
+  size_t datacap, have ;
+  size_t pos, len ;             /* read ahead, not yet taken */
+  char buf[4096] ;
+} Conn ;
+
+/* What a worker keeps between requests; buffers only ever grow */
+typedef struct {
+  pthread_t thread ;
+  int epfd ;
+  int listenfd ;
+  Bdf2fonFont *font ;           /* last font parsed, for its memory */
+  unsigned char *out[SERVE_MAXPARTS] ;
+  size_t outcap[SERVE_MAXPARTS], outsize[SERVE_MAXPARTS] ;
+  unsigned char *fon ;
+  size_t foncap ;
+  char msg[256] ;
+} Worker ;
+
+/* Payload bytes all connections hold, against SERVE_MAXBUFFERED */
+static pthread_mutex_t budgetlock = PTHREAD_MUTEX_INITIALIZER ;
+static size_t buffered ;
+
+/* Grow conn's payload buffer to size bytes if the budget allows it */
+static int takebudget(Conn *conn, size_t size)
+{
+  void *p = NULL ;
+  int ok ;
+
+  if ( size <= conn->datacap )
+    return 1 ;
+  pthread_mutex_lock(&budgetlock) ;
+  ok = size - conn->datacap <= SERVE_MAXBUFFERED - buffered ;
+  if ( ok )
+    buffered += size - conn->datacap ;
+  pthread_mutex_unlock(&budgetlock) ;
+  if ( ok && (p = realloc(conn->data, size)) == NULL ) {
+    pthread_mutex_lock(&budgetlock) ;
+    buffered -= size - conn->datacap ;
+    pthread_mutex_unlock(&budgetlock) ;
+  }
+  if ( p == NULL )
+    return 0 ;
+  conn->data = (char *)p ;
+  conn->datacap = size ;
+  return 1 ;
+}
+
+/* Free conn's payload buffer and give its bytes back to the budget */
+static void dropbudget(Conn *conn)
+{
+  pthread_mutex_lock(&budgetlock) ;
+  buffered -= conn->datacap ;
+  pthread_mutex_unlock(&budgetlock) ;
+  free(conn->data) ;
+  conn->data = NULL ;
+  conn->datacap = 0 ;
+}
+
+static long long now(void)
+{
+  struct timespec ts ;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts) ;
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000 ;
+}
+
+/* Send all of data by deadline (a now() time), however the client reads:
+   one that stops, or takes a few bytes at a time, is given up on then */
+static int sendall(int fd, const void *data, size_t size, long long deadline)
+{
+  size_t done ;
+
+  for ( done = 0 ; done < size ; ) {
+    ssize_t n = send(fd, (const char *)data + done, size - done, MSG_NOSIGNAL) ;
+    if ( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ) {
+      struct pollfd pfd ;
+      long long wait = deadline - now() ;
+      int r ;
+      pfd.fd = fd ;
+      pfd.events = POLLOUT ;
+      if ( wait <= 0 )
+        return 0 ;
+      r = poll(&pfd, 1, wait > SEND_TIMEOUT ? SEND_TIMEOUT : (int)wait) ;
+      if ( r < 0 && errno != EINTR )
+        return 0 ;
+      continue ;
+    }
+    if ( n < 0 && errno == EINTR )
+      continue ;
+    if ( n <= 0 )
+      return 0 ;
+    done += n ;
+  }
+  return 1 ;
+}
+
+/* Fill in rq from a header line; returns NULL or what is wrong with it */
+static const char *parserequest(char *line, Request *rq)
+{
+  char *word, *save, *end ;
+
+  memset(rq, 0, sizeof(*rq)) ;
+  rq->options.version = BDF2FON_WINDOWS_2 ;
+  rq->scale = 1 ;
+  if ( (word = strtok_r(line, " \t\r", &save)) == NULL )
+    return "empty request" ;
+  if ( strcmp(word, "fon") == 0 )
+    rq->fon = 1 ;
+  else if ( strcmp(word, "fnt") != 0 )
+    return "unknown request" ;
+
+  while ( (word = strtok_r(NULL, " \t\r", &save)) != NULL ) {
+    if ( strcmp(word, "-c") == 0 )
+      rq->options.oem = 1 ;
+    else if ( strcmp(word, "-2") == 0 || strcmp(word, "-2.0") == 0 )
+      rq->options.version = BDF2FON_WINDOWS_2 ;
+    else if ( strcmp(word, "-3") == 0 || strcmp(word, "-3.0") == 0 )
+      rq->options.version = BDF2FON_WINDOWS_3_0 ;
+    else if ( strcmp(word, "-3.1") == 0 )
+      rq->options.version = BDF2FON_WINDOWS_3_1 ;
+    else if ( strcmp(word, "--chars") == 0 ) {
+      char *arg = strtok_r(NULL, " \t\r", &save) ;
+      if ( arg == NULL || bdf2fon_charset(arg, rq->chars) != BDF2FON_OK )
+        return "bad --chars" ;
+      rq->subset = 1 ;
+    }
+    else if ( strcmp(word, "-p") == 0 || strcmp(word, "-x") == 0 ||
+              strcmp(word, "-n") == 0 ) {
+      char *arg = strtok_r(NULL, " \t\r", &save) ;
+      long v ;
+      if ( arg == NULL )
+        return "option needs an argument" ;
+      if ( word[1] == 'n' ) {
+        strcpy(rq->name, arg) ;
+        rq->options.name = rq->name ;
+        continue ;
+      }
+      v = strtol(arg, &end, 10) ;
+      if ( *end || v < 1 || (word[1] == 'x' && v > BDF2FON_MAXSCALE) || v > 65535 )
+        return "bad option argument" ;
+      if ( word[1] == 'p' )
+        rq->options.codepage = v ;
+      else
+        rq->scale = v ;
+    } else if ( *word == '-' )
+      return "unknown option" ;
+    else {
+      unsigned long long v = strtoull(word, &end, 10) ;
+      if ( *end || *word < '0' || *word > '9' )
+        return "bad size" ;
+      if ( rq->nparts == SERVE_MAXPARTS || (rq->nparts == 1 && ! rq->fon) )
+        return "too many parts" ;
+      if ( v > (unsigned long long)(SERVE_MAXREQUEST - rq->total) )
+        return "request too large" ;
+      rq->sizes[rq->nparts++] = v ;
+      rq->total += v ;
+    }
+  }
+  return rq->nparts ? NULL : "no size" ;
+}
+
+/* Make room for size bytes at *buf */
+static int reserve(void *buf, size_t *cap, size_t size)
+{
+  void *p ;
+
+  if ( size <= *cap )
+    return 1 ;
+  if ( (p = realloc(*(void **)buf, size)) == NULL )
+    return 0 ;
+  *(void **)buf = p ;
+  *cap = size ;
+  return 1 ;
+}
+
+/* Encode one .fnt into out[k], growing it until the image fits; twice
+   the size asked for, since the library builds in place only when the
+   buffer holds its worst case */
+static int encode(Worker *w, int k, const Bdf2fonFont *fnt, const Bdf2fonOptions *options)
+{
+  int err ;
+
+  if ( ! reserve(&w->out[k], &w->outcap[k], 65536) )
+    return BDF2FON_ENOMEM ;
+  for (;;) {
+    unsigned char *image = w->out[k] ;
+    w->outsize[k] = w->outcap[k] ;
+    if ( (err = bdf2fon_fnt(fnt, options, &image, &w->outsize[k])) != BDF2FON_ESPACE )
+      return err ;
+    if ( ! reserve(&w->out[k], &w->outcap[k], w->outsize[k] * 2) )
+      return BDF2FON_ENOMEM ;
+  }
+}
+
+/* Convert the parts of a request read into data; returns NULL with the
+   reply in *reply, or an error message */
+static const char *handle(Worker *w, const Request *rq, const char *data,
+                          const unsigned char **reply, size_t *replysize)
+{
+  const unsigned char *fnts[SERVE_MAXPARTS] ;
+  int flags = BDF2FON_REUSE | (rq->options.codepage ? BDF2FON_UNICODE : 0) ;
+  int i, err ;
+
+  for ( i = 0 ; i < rq->nparts ; data += rq->sizes[i++] ) {
+    const Bdf2fonFont *fnt ;
+    Bdf2fonFont *scaled = NULL ;
+    long errline = 0 ;
+
+    /* a .fnt starts with its version, 0x200 or 0x300; text never with NUL */
+    if ( rq->fon && rq->sizes[i] >= 2 && data[0] == 0 && (data[1] == 2 || data[1] == 3) ) {
+      fnts[i] = (const unsigned char *)data ;
+      w->outsize[i] = rq->sizes[i] ;
+      continue ;
+    }
+    err = bdf2fon_parsesubset(data, rq->sizes[i], flags, rq->subset ? rq->chars : NULL,
+                              NULL, &w->font, &errline) ;
+    if ( err == BDF2FON_OK && rq->scale > 1 )
+      err = bdf2fon_scale(w->font, rq->scale, &scaled) ;
+    fnt = scaled ? scaled : w->font ;
+    if ( err == BDF2FON_OK )
+      err = encode(w, i, fnt, &rq->options) ;
+    bdf2fon_free(scaled) ;
+    if ( err != BDF2FON_OK ) {
+      if ( err == BDF2FON_EPARSE )
+        snprintf(w->msg, sizeof(w->msg), "part %d: can't parse line %ld", i + 1, errline) ;
+      else
+        snprintf(w->msg, sizeof(w->msg), "part %d: %s", i + 1, bdf2fon_strerror(err)) ;
+      return w->msg ;
+    }
+    fnts[i] = w->out[i] ;
+  }
+
+  if ( ! rq->fon ) {
+    *reply = fnts[0] ;
+    *replysize = w->outsize[0] ;
+    return NULL ;
+  }
+  if ( ! reserve(&w->fon, &w->foncap, 65536) )
+    return bdf2fon_strerror(BDF2FON_ENOMEM) ;
+  for (;;) {
+    unsigned char *image = w->fon ;
+    *replysize = w->foncap ;
+    err = bdf2fon_fon(fnts, w->outsize, rq->nparts, &image, replysize) ;
+    if ( err != BDF2FON_ESPACE )
+      break ;
+    if ( ! reserve(&w->fon, &w->foncap, *replysize) )
+      return bdf2fon_strerror(BDF2FON_ENOMEM) ;
+  }
+  if ( err != BDF2FON_OK )
+    return bdf2fon_strerror(err) ;
+  *reply = w->fon ;
+  return NULL ;
+}
+
+/* Reply to the request whose payload conn has read in full */
+static int answer(Worker *w, Conn *conn)
+{
+  char status[320] ;
+  const char *msg ;
+  const unsigned char *reply = NULL ;
+  size_t size = 0 ;
+  long long deadline ;
+
+  if ( (msg = handle(w, &conn->rq, conn->data, &reply, &size)) != NULL )
+    snprintf(status, sizeof(status), "error %s\n", msg) ;
+  else
+    snprintf(status, sizeof(status), "ok %lu\n", (unsigned long)size) ;
+  if ( conn->datacap > KEEP_PAYLOAD )
+    dropbudget(conn) ;
+  deadline = now() + SEND_TIMEOUT ;
+  return sendall(conn->fd, status, strlen(status), deadline) &&
+         sendall(conn->fd, reply, size, deadline) ;
+}
+
+/* Take what conn has sent so far, and answer the request once its
+   payload is all in.  Returns 1 when the socket has nothing more for now
+   or a request has been answered, 0 once the connection should close: at
+   its end, on a header that is too long or can't be read, or when a reply
+   can't be sent. */
+static int progress(Worker *w, Conn *conn)
+{
+  for (;;) {
+    ssize_t n ;
+    size_t k ;
+
+    /* one request per wakeup, so that clients take turns; anything read
+       ahead waits for the event watch() arranges for it */
+    if ( conn->payload && conn->have == conn->rq.total ) {
+      conn->payload = 0 ;
+      return answer(w, conn) ;
+    }
+    if ( conn->pos == conn->len ) {
+      /* the rest of a payload goes straight into place */
+      if ( conn->payload )
+        n = read(conn->fd, conn->data + conn->have, conn->rq.total - conn->have) ;
+      else
+        n = read(conn->fd, conn->buf, sizeof(conn->buf)) ;
+      if ( n < 0 && errno == EINTR )
+        continue ;
+      if ( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+        return 1 ;
+      if ( n <= 0 )
+        return 0 ;
+      if ( conn->payload ) {
+        conn->have += n ;
+        continue ;
+      }
+      conn->pos = 0 ;
+      conn->len = n ;
+    }
+
+    if ( conn->payload ) {
+      k = conn->len - conn->pos ;
+      if ( k > conn->rq.total - conn->have )
+        k = conn->rq.total - conn->have ;
+      memcpy(conn->data + conn->have, conn->buf + conn->pos, k) ;
+      conn->have += k ;
+      conn->pos += k ;
+    } else {
+      char *nl = (char *)memchr(conn->buf + conn->pos, '\n', conn->len - conn->pos) ;
+      const char *msg ;
+
+      k = (nl ? (size_t)(nl - conn->buf) : conn->len) - conn->pos ;
+      if ( conn->hlen + k >= sizeof(conn->header) )
+        return 0 ;
+      memcpy(conn->header + conn->hlen, conn->buf + conn->pos, k) ;
+      conn->hlen += k ;
+      conn->pos += k ;
+      if ( nl == NULL )
+        continue ;
+      conn->pos++ ;
+      conn->header[conn->hlen] = '\0' ;
+      conn->hlen = 0 ;
+      msg = parserequest(conn->header, &conn->rq) ;
+      /* without the payload in hand there is no next request to find */
+      if ( msg == NULL && ! takebudget(conn, conn->rq.total) )
+        msg = "server busy" ;
+      if ( msg ) {
+        char status[320] ;
+        snprintf(status, sizeof(status), "error %s\n", msg) ;
+        sendall(conn->fd, status, strlen(status), now() + SEND_TIMEOUT) ;
+        return 0 ;
+      }
+      conn->payload = 1 ;
+      conn->have = 0 ;
+    }
+  }
+}
+
+static void hangup(Conn *conn)
+{
+  close(conn->fd) ;             /* also leaves the epoll set */
+  dropbudget(conn) ;
+  free(conn) ;
+}
+
+/* Wait for (one shot, EPOLLONESHOT) readiness to watch fd again.  A
+   connection with input read ahead won't become readable for it, so it
+   waits to be writable instead, which it mostly already is: it joins the
+   back of the ready list rather than keeping its worker. */
+static int watch(int epfd, int op, int fd, Conn *conn)
+{
+  struct epoll_event ev ;
+
+  ev.events = EPOLLIN | EPOLLONESHOT ;
+  if ( conn && conn->pos < conn->len )
+    ev.events |= EPOLLOUT ;
+  ev.data.ptr = conn ;
+  return epoll_ctl(epfd, op, fd, &ev) ;
+}
+
+/* Marks the event of serve()'s stop pipe, which stays ready once closed
+   so that every worker sees it */
+static char stopping ;
+
+/* Workers share one epoll set holding the listening socket and every
+   connection, each armed for one event at a time.  Connections are
+   nonblocking and a worker only takes what has arrived, so whichever
+   worker is free takes the next request from any client: many clients on
+   few workers take turns, and one that sends half a request holds no
+   worker while the rest of it is on its way. */
+static void *worker(void *arg)
+{
+  Worker *w = (Worker *)arg ;
+  struct epoll_event ev ;
+
+  for (;;) {
+    Conn *conn ;
+    int fd ;
+
+    if ( epoll_wait(w->epfd, &ev, 1, -1) < 0 ) {
+      if ( errno == EINTR )
+        continue ;
+      break ;
+    }
+    if ( ev.data.ptr == &stopping )
+      break ;
+    if ( (conn = (Conn *)ev.data.ptr) == NULL ) {     /* the listening socket */
+      fd = accept4(w->listenfd, NULL, NULL, SOCK_NONBLOCK) ;
+      watch(w->epfd, EPOLL_CTL_MOD, w->listenfd, NULL) ;
+      if ( fd < 0 )
+        continue ;
+      if ( (conn = (Conn *)calloc(1, sizeof(Conn))) == NULL ||
+           (conn->fd = fd, watch(w->epfd, EPOLL_CTL_ADD, fd, conn)) < 0 ) {
+        free(conn) ;
+        close(fd) ;
+      }
+      continue ;
+    }
+
+    if ( ! progress(w, conn) || watch(w->epfd, EPOLL_CTL_MOD, conn->fd, conn) < 0 )
+      hangup(conn) ;
+  }
+  return NULL ;
+}
+
+/* Bind path, replacing a socket left behind by a server that is gone */
+static int listenon(const char *path)
+{
+  struct sockaddr_un addr ;
+  struct stat st ;
+  int fd ;
+
+  if ( strlen(path) >= sizeof(addr.sun_path) ) {
+    errno = ENAMETOOLONG ;
+    return -1 ;
+  }
+  memset(&addr, 0, sizeof(addr)) ;
+  addr.sun_family = AF_UNIX ;
+  strcpy(addr.sun_path, path) ;
+
+  if ( lstat(path, &st) == 0 && S_ISSOCK(st.st_mode) &&
+       (fd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0 ) {
+    if ( connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 &&
+         errno == ECONNREFUSED )
+      unlink(path) ;
+    close(fd) ;
+  }
+
+  if ( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 )
+    return -1 ;
+  /* nonblocking, so a client gone before accept() can't stall a worker */
+  if ( bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+       listen(fd, SOMAXCONN) < 0 || fcntl(fd, F_SETFL, O_NONBLOCK) < 0 ) {
+    int saved = errno ;
+    close(fd) ;
+    errno = saved ;
+    return -1 ;
+  }
+  return fd ;
+}
+
+int serve(const char *path, int nworkers)
+{
+  sigset_t stop ;
+  Worker *workers ;
+  struct epoll_event ev ;
+  int fd, epfd, stoppipe[2], i, k, sig, started = 0 ;
+
+  if ( nworkers <= 0 ) {
+#ifdef _SC_NPROCESSORS_ONLN
+    nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN) ;
+#endif
+    if ( nworkers <= 0 )
+      nworkers = 1 ;
+  }
+  if ( (workers = (Worker *)calloc(nworkers, sizeof(Worker))) == NULL )
+    return -1 ;
+  if ( (fd = listenon(path)) < 0 ) {
+    free(workers) ;
+    return -1 ;
+  }
+  ev.events = EPOLLIN ;          /* level triggered: wakes every worker */
+  ev.data.ptr = &stopping ;
+  stoppipe[0] = stoppipe[1] = -1 ;
+  if ( (epfd = epoll_create1(0)) < 0 || watch(epfd, EPOLL_CTL_ADD, fd, NULL) < 0 ||
+       pipe(stoppipe) < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, stoppipe[0], &ev) < 0 ) {
+    int saved = errno ;
+    close(stoppipe[0]) ;
+    close(stoppipe[1]) ;
+    if ( epfd >= 0 )
+      close(epfd) ;
+    close(fd) ;
+    unlink(path) ;
+    free(workers) ;
+    errno = saved ;
+    return -1 ;
+  }
+
+  /* workers inherit the mask; only this thread takes the signals */
+  sigemptyset(&stop) ;
+  sigaddset(&stop, SIGINT) ;
+  sigaddset(&stop, SIGTERM) ;
+  pthread_sigmask(SIG_BLOCK, &stop, NULL) ;
+  for ( i = 0 ; i < nworkers ; i++ ) {
+    Worker *w = &workers[started] ;
+    w->epfd = epfd ;
+    w->listenfd = fd ;
+    if ( pthread_create(&w->thread, NULL, worker, w) == 0 )
+      started++ ;
+  }
+  if ( started > 0 )
+    sigwait(&stop, &sig) ;
+
+  /* closing the pipe leaves it readable for good; each worker finishes
+     the request in hand, then sees that */
+  unlink(path) ;
+  close(stoppipe[1]) ;
+  for ( i = 0 ; i < started ; i++ ) {
+    Worker *w = &workers[i] ;
+    pthread_join(w->thread, NULL) ;
+    bdf2fon_free(w->font) ;
+    for ( k = 0 ; k < SERVE_MAXPARTS ; k++ )
+      free(w->out[k]) ;
+    free(w->fon) ;
+  }
+  close(stoppipe[0]) ;
+  close(epfd) ;
+  close(fd) ;
+  free(workers) ;
+  if ( started == 0 ) {
+    errno = EAGAIN ;
+    return -1 ;
+  }
+  return 0 ;                    /* connections still open close at exit */
+}
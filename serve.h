@@ -0,0 +1,30 @@
+/*
+ * serve.h
+ */
+
+/* bdf2fnt -S: convert requests from a Unix domain socket in a long-running
+   process, so that each one pays neither process startup nor cold memory.
+   A request is one header line of words separated by spaces, followed by
+   the bytes it announces:
+
+     fnt [options] size\n            then size bytes of BDF
+     fon [options] size size ...\n   then each part, in order
+
+   The options are bdf2fnt's: -c, -2, -3.0, -3.1, -p cp, -x n (one code
+   page and one scale factor), --chars list and -n fontname, without
+   spaces.  BDF may be gzip-compressed.  A fon part is a BDF converted
+   with those options, or a finished .fnt taken as is.
+   The reply is "ok size\n" and the .fnt or .fon bytes, or "error
+   message\n".  A connection may carry any number of requests; it is
+   closed after a header that can't be read, after "error server busy"
+   when the payloads of all connections would pass SERVE_MAXBUFFERED, or
+   when the client takes more than 10 seconds to read a reply. */
+
+#define SERVE_MAXPARTS    64
+#define SERVE_MAXREQUEST  (256L << 20)  /* bytes of payload */
+#define SERVE_MAXBUFFERED (1L << 30)    /* bytes of payload, all connections */
+
+/* Listen on path with nworkers threads (0 for one per CPU) until SIGINT
+   or SIGTERM; returns 0 then, once the workers have finished the requests
+   in hand, or -1 with errno set if the socket could not be set up */
+int serve(const char *path, int nworkers) ;
@@ -0,0 +1,255 @@
+#!/bin/sh
+# check.sh - regression checks run by "make check" from the top directory.
+# Each check converts the fonts in test/ and compares the result with a
+# conversion known to be right; it prints what failed and exits 1.
+# The converters' own chatter on stdout is dropped.
+
+t=$(mktemp -d) || exit 1
+trap 'rm -rf "$t"' EXIT
+failed=0
+exec 3>&1 >/dev/null
+
+fail()
+{
+  echo "FAIL: $*" >&3
+  failed=1
+}
+
+# dump name code...: compare the header and the given glyphs of $t/name.fnt
+# with test/name.txt
+dump()
+{
+  name=$1
+  shift
+  test/fntdump "$t/$name.fnt" "$@" > "$t/$name.txt" &&
+    diff -u "test/$name.txt" "$t/$name.txt" >&3 || fail "$name.fnt differs"
+}
+
+# a second font with its own name, so batch jobs are told apart
+sed 's/Sample/Other/' test/sample.bdf > "$t/other.bdf"
+
+# batch mode: pairs, a pool of workers and stdin lines give what one
+# conversion at a time gives; a bad input fails only its own job
+./bdf2fnt -q test/sample.bdf "$t/sample.fnt" || fail "convert sample.bdf"
+./bdf2fnt -q "$t/other.bdf" "$t/other.fnt" || fail "convert other.bdf"
+./bdf2fnt -q -b test/sample.bdf "$t/b1.fnt" "$t/other.bdf" "$t/b2.fnt" ||
+  fail "batch pairs"
+./bdf2fnt -q -j 4 -b "$t/other.bdf" "$t/j1.fnt" test/sample.bdf "$t/j2.fnt" ||
+  fail "batch -j 4"
+printf '# manifest\n\ntest/sample.bdf %s Renamed\n%s %s\n' \
+  "$t/m1.fnt" "$t/other.bdf" "$t/m2.fnt" | ./bdf2fnt -q -b ||
+  fail "batch from stdin"
+./bdf2fnt -q test/sample.bdf "$t/renamed.fnt" Renamed || fail "convert with name"
+for f in b1:sample b2:other j1:other j2:sample m1:renamed m2:other ; do
+  cmp -s "$t/${f%:*}.fnt" "$t/${f#*:}.fnt" || fail "batch ${f%:*}.fnt differs"
+done
+if ./bdf2fnt -q -b /nonexistent.bdf "$t/bad.fnt" test/sample.bdf "$t/good.fnt" \
+     2>/dev/null ; then
+  fail "batch with a missing input succeeded"
+fi
+cmp -s "$t/good.fnt" "$t/sample.fnt" || fail "batch job after a failed one"
+
+# the input buffer: a pipe, CRLF line ends, no final newline and a file
+# ending exactly on a page boundary all read like the plain file
+cat test/sample.bdf | ./bdf2fnt -q /dev/stdin "$t/pipe.fnt" &&
+  cmp -s "$t/pipe.fnt" "$t/sample.fnt" || fail "piped input differs"
+sed 's/$/\r/' test/sample.bdf > "$t/crlf.bdf"
+./bdf2fnt -q "$t/crlf.bdf" "$t/crlf.fnt" && cmp -s "$t/crlf.fnt" "$t/sample.fnt" ||
+  fail "CRLF input differs"
+printf '%s' "$(cat test/sample.bdf)" > "$t/nonl.bdf"
+./bdf2fnt -q "$t/nonl.bdf" "$t/nonl.fnt" && cmp -s "$t/nonl.fnt" "$t/sample.fnt" ||
+  fail "input without a final newline differs"
+pad=$((4096 - $(wc -c < test/sample.bdf) % 4096 - 9))
+{ printf 'COMMENT %*s\n' $pad '' ; cat test/sample.bdf ; } > "$t/page.bdf"
+test $(($(wc -c < "$t/page.bdf") % 4096)) -eq 0 || fail "page.bdf size"
+./bdf2fnt -q "$t/page.bdf" "$t/page.fnt" && cmp -s "$t/page.fnt" "$t/sample.fnt" ||
+  fail "page-sized input differs"
+
+# numbers: tabs, runs of blanks and explicit plus signs between fields
+sed -e 's/ \([0-9]\)/ \t +\1/g' -e 's/ -\([0-9]\)/\t  -\1/g' test/sample.bdf \
+  > "$t/blanks.bdf"
+./bdf2fnt -q "$t/blanks.bdf" "$t/blanks.fnt" &&
+  cmp -s "$t/blanks.fnt" "$t/sample.fnt" || fail "spaced-out numbers differ"
+
+# the SIMD BITMAP row decoders agree with the scalar one
+test/hexrow >&3 || fail "BITMAP row decoders differ"
+
+# a glyph with a wide DWIDTH and no BITMAP still gets its full cell
+./bdf2fnt -q test/dwidth-nobitmap.bdf "$t/dwidth-nobitmap.fnt" ||
+  fail "convert dwidth-nobitmap.bdf"
+dump dwidth-nobitmap 65 66
+
+# the image: header fields, gaps and the default slot, descenders, and
+# glyphs wider than 32 px; identical glyphs share one raster
+dump sample 32 33 63 64 65 87 103 146 129 147
+./bdf2fnt -q test/wide.bdf "$t/wide.fnt" || fail "convert wide.bdf"
+dump wide 63 65 66 67 129
+
+# code pages: one parse, one .fnt per page; the OEM pages show symbols
+# for the control codes and DEL, the Windows pages do not
+./bdf2fnt -q -p 437,866,1252 test/unicode.bdf "$t/unicode.fnt" ||
+  fail "convert unicode.bdf to code pages"
+dump unicode_437 1 65 127 128
+dump unicode_866 1 128 134
+dump unicode_1252 1 127 128 199
+
+# .fon straight from BDF input is what bdf2fnt then fnt2fon make
+./fnt2fon "$t/sample.fnt" "$t/wide.fnt" "$t/pair.fon" 2>/dev/null || fail "fnt2fon"
+./bdf2fnt -q -f "$t/direct.fon" test/sample.bdf test/wide.bdf &&
+  cmp -s "$t/direct.fon" "$t/pair.fon" || fail "bdf2fnt -f differs from fnt2fon"
+
+# fnt2fon reads each input once: from a pipe as from a file, and a .fnt
+# cut short of its dfSize is refused
+cat "$t/wide.fnt" | ./fnt2fon "$t/sample.fnt" - "$t/piped.fon" 2>/dev/null &&
+  cmp -s "$t/piped.fon" "$t/pair.fon" || fail "fnt2fon from a pipe differs"
+head -c 600 "$t/sample.fnt" > "$t/short.fnt"
+if ./fnt2fon "$t/short.fnt" "$t/short.fon" 2>/dev/null ; then
+  fail "fnt2fon took a truncated .fnt"
+fi
+
+# fnt2fon sizes its output before filling it in: a longer file already
+# there is cut to length, and padding reads back as zeros
+head -c 100000 /dev/urandom > "$t/over.fon"
+./fnt2fon "$t/sample.fnt" "$t/wide.fnt" "$t/over.fon" 2>/dev/null &&
+  cmp -s "$t/over.fon" "$t/pair.fon" || fail "fnt2fon over an existing file differs"
+
+# the output cache: a second run is a hit, linked to the same bytes; an
+# option that changes the output misses; fnt2fon caches the same way
+mkdir "$t/cache"
+./bdf2fnt -C "$t/cache" test/sample.bdf "$t/c1.fnt" 2> "$t/c1.err" &&
+  grep -q "0 hits, 1 misses" "$t/c1.err" || fail "first cached run did not miss"
+./bdf2fnt -C "$t/cache" test/sample.bdf "$t/c2.fnt" 2> "$t/c2.err" &&
+  grep -q "1 hits, 0 misses" "$t/c2.err" || fail "second cached run did not hit"
+cmp -s "$t/c1.fnt" "$t/sample.fnt" && cmp -s "$t/c2.fnt" "$t/sample.fnt" ||
+  fail "cached output differs"
+test "$(ls -l "$t/c2.fnt" | awk '{ print $2 }')" -gt 1 || fail "cache hit is not a link"
+./bdf2fnt -C "$t/cache" -c test/sample.bdf "$t/c3.fnt" 2> "$t/c3.err" &&
+  grep -q "0 hits, 1 misses" "$t/c3.err" || fail "cached run with -c did not miss"
+./bdf2fnt -q -c test/sample.bdf "$t/oem.fnt" && cmp -s "$t/c3.fnt" "$t/oem.fnt" ||
+  fail "cached output with -c differs"
+for i in 1 2 ; do
+  ./fnt2fon -C "$t/cache" "$t/sample.fnt" "$t/wide.fnt" "$t/c$i.fon" 2>/dev/null &&
+    cmp -s "$t/c$i.fon" "$t/pair.fon" || fail "cached fnt2fon run $i differs"
+done
+test "$(ls "$t/cache" | wc -l)" -eq 3 || fail "cache holds other than 3 entries"
+
+# integer scaling: 1x is the plain output, 2x-4x widen every pixel,
+# including rows wider than the SIMD kernels take in one step
+./bdf2fnt -q -x 1,2,3,4 test/sample.bdf "$t/scaled.fnt" ||
+  fail "convert sample.bdf with -x 1,2,3,4"
+cmp -s "$t/scaled.fnt" "$t/sample.fnt" || fail "-x 1 differs from the plain output"
+dump scaled_2x 33 65 103
+dump scaled_3x 65
+dump scaled_4x 87
+./bdf2fnt -q -x 2 test/wide.bdf "$t/widescaled.fnt" || fail "convert wide.bdf with -x 2"
+dump widescaled_2x 65
+
+# progress goes to stderr, so a .fnt on stdout is the plain output; -q
+# silences it; --stats adds one JSON object with the counts on stderr
+./bdf2fnt test/sample.bdf > "$t/stdout.fnt" 2> "$t/progress" &&
+  cmp -s "$t/stdout.fnt" "$t/sample.fnt" || fail ".fnt on stdout differs"
+grep -q "^Sample: " "$t/progress" || fail "no progress line on stderr"
+./bdf2fnt -q test/sample.bdf "$t/quiet.fnt" 2> "$t/quiet" && test ! -s "$t/quiet" ||
+  fail "-q still prints"
+./bdf2fnt -q --stats test/sample.bdf "$t/stats.fnt" 2> "$t/stats.json" ||
+  fail "convert with --stats"
+for f in '"program": "bdf2fnt"' '"glyphs": 7' '"STARTCHAR": 7' '"other": 0' ; do
+  grep -q "$f" "$t/stats.json" || fail "--stats lacks $f"
+done
+./fnt2fon --stats "$t/sample.fnt" "$t/stats.fon" 2> "$t/stats.json" &&
+  grep -q '"face": "Sample"' "$t/stats.json" || fail "fnt2fon --stats"
+
+# every .fnt and .fon written above passes fntcheck, and the truncated
+# one does not
+ls "$t"/*.fnt "$t"/*.fon | grep -v '/short\.fnt$' | ./fntcheck > "$t/fntcheck.out" ||
+  { cat "$t/fntcheck.out" >&3 ; fail "fntcheck rejects an output" ; }
+if ./fntcheck "$t/short.fnt" > /dev/null ; then
+  fail "fntcheck accepts a truncated .fnt"
+fi
+
+# the library on its own: caller buffers, BDF2FON_ESPACE and parse errors,
+# and its .fon is fnt2fon's
+test/libcheck "$t/lib.fon" test/sample.bdf test/wide.bdf >&3 &&
+  cmp -s "$t/lib.fon" "$t/pair.fon" || fail "libbdf2fon .fon differs"
+
+# the server gives what the command line does, for .fnt and .fon requests
+# on one connection after another, and reports a bad BDF without going away
+./bdf2fnt -S "$t/sock" -j 2 2>/dev/null &
+server=$!
+for i in 1 2 3 4 5 6 7 8 9 10 ; do
+  test -S "$t/sock" && break
+  sleep 1
+done
+./bdf2fntc -S "$t/sock" test/sample.bdf "$t/served.fnt" &&
+  cmp -s "$t/served.fnt" "$t/sample.fnt" || fail "served .fnt differs"
+./bdf2fntc -S "$t/sock" -p 1252 test/unicode.bdf "$t/served_1252.fnt" &&
+  cmp -s "$t/served_1252.fnt" "$t/unicode_1252.fnt" || fail "served -p 1252 differs"
+./bdf2fntc -S "$t/sock" -x 2 test/sample.bdf "$t/served_2x.fnt" &&
+  cmp -s "$t/served_2x.fnt" "$t/scaled_2x.fnt" || fail "served -x 2 differs"
+./bdf2fntc -S "$t/sock" -f "$t/served.fon" test/sample.bdf "$t/wide.fnt" &&
+  cmp -s "$t/served.fon" "$t/pair.fon" || fail "served .fon differs"
+head -c 700 test/sample.bdf > "$t/cut.bdf"
+if ./bdf2fntc -S "$t/sock" "$t/cut.bdf" "$t/cut.fnt" 2>/dev/null ; then
+  fail "server converts a truncated BDF"
+fi
+./bdf2fntc -S "$t/sock" test/wide.bdf "$t/served_wide.fnt" &&
+  cmp -s "$t/served_wide.fnt" "$t/wide.fnt" || fail "server fails after an error"
+kill $server
+wait $server || fail "server did not stop cleanly"
+test ! -e "$t/sock" || fail "server left its socket behind"
+
+# 3.x: the same glyphs behind a 148-byte header and 6-byte entries; a
+# font too big for 2.x is refused there, and as 3.x goes into a .fon past
+# 1MB, whose resources then need a larger alignment shift
+./bdf2fnt -q -3.0 test/sample.bdf "$t/sample3.fnt" || fail "convert sample.bdf with -3.0"
+dump sample3 32 65 129
+bench/genbdf 64 180 > "$t/big.bdf"
+if ./bdf2fnt -q -x 5 "$t/big.bdf" "$t/big2.fnt" 2> "$t/big2.err" ; then
+  fail "2.x .fnt past 64K accepted"
+fi
+grep -q "too large for a 2.x .fnt" "$t/big2.err" || fail "no 2.x size error"
+./bdf2fnt -q -3.0 -x 5 "$t/big.bdf" "$t/big.fnt" || fail "convert a 3.x font past 1MB"
+./fnt2fon "$t/sample.fnt" "$t/big_5x.fnt" "$t/sample3.fnt" "$t/big.fon" 2>/dev/null &&
+  test $(wc -c < "$t/big.fon") -gt 1048576 || fail "fnt2fon past 1MB"
+./fntcheck "$t/big.fon" "$t/big_5x.fnt" "$t/sample3.fnt" > "$t/big.out" ||
+  { cat "$t/big.out" >&3 ; fail "fntcheck rejects the 3.x outputs" ; }
+
+# --chars: only the glyphs asked for, ending at the last of them with the
+# default among them; asking for every code is the whole conversion, and
+# a property block that never ends reads the same with or without it
+./bdf2fnt -q --chars 32-126 test/sample.bdf "$t/chars.fnt" || fail "convert with --chars"
+dump chars 32 63 65 103 126
+./bdf2fnt -q --chars 0-0xff test/sample.bdf "$t/allchars.fnt" &&
+  cmp -s "$t/allchars.fnt" "$t/sample.fnt" || fail "--chars 0-0xff differs from the plain output"
+glyphs() { test/fntdump "$1" 32 65 66 | sed -e '1,4d' -e 's/ offset.*//' ; }
+./bdf2fnt -q test/dwidth-noendprops.bdf "$t/noendprops.fnt" &&
+  ./bdf2fnt -q --chars 0-0xff test/dwidth-noendprops.bdf "$t/noendprops_chars.fnt" &&
+  glyphs "$t/noendprops.fnt" > "$t/noendprops.txt" &&
+  glyphs "$t/noendprops_chars.fnt" | cmp -s - "$t/noendprops.txt" ||
+  fail "--chars reads a block without ENDPROPERTIES differently"
+./bdf2fnt -q --chars 65 test/dwidth-noendprops.bdf "$t/noendprops_65.fnt" &&
+  ./fntcheck "$t/chars.fnt" "$t/noendprops.fnt" "$t/noendprops_65.fnt" > "$t/chars.out" ||
+  { cat "$t/chars.out" >&3 ; fail "--chars output rejected" ; }
+
+# gzip input converts as the plain text does, also when split in members
+# and with --chars across inflate refills; a truncated or corrupt stream
+# is an error, not a font
+gzip -c test/sample.bdf > "$t/sample.bdf.gz"
+./bdf2fnt -q "$t/sample.bdf.gz" "$t/gz.fnt" &&
+  cmp -s "$t/gz.fnt" "$t/sample.fnt" || fail "gzip input differs"
+head -c 1500 test/sample.bdf | gzip -c > "$t/members.bdf.gz"
+tail -c +1501 test/sample.bdf | gzip -c >> "$t/members.bdf.gz"
+./bdf2fnt -q "$t/members.bdf.gz" "$t/members.fnt" &&
+  cmp -s "$t/members.fnt" "$t/sample.fnt" || fail "multi-member gzip input differs"
+gzip -c "$t/big.bdf" > "$t/big.bdf.gz"
+./bdf2fnt -q --chars 32-126 "$t/big.bdf" "$t/bigchars.fnt" &&
+  ./bdf2fnt -q --chars 32-126 "$t/big.bdf.gz" "$t/bigchars_gz.fnt" &&
+  cmp -s "$t/bigchars_gz.fnt" "$t/bigchars.fnt" || fail "gzip input with --chars differs"
+size=$(wc -c < "$t/big.bdf.gz")
+head -c $((size / 2)) "$t/big.bdf.gz" > "$t/cut.bdf.gz"
+if ./bdf2fnt -q "$t/cut.bdf.gz" "$t/cutgz.fnt" 2> "$t/cutgz.err" ; then
+  fail "truncated gzip input accepted"
+fi
+grep -q "gzip" "$t/cutgz.err" || fail "no gzip error for a truncated stream"
+
+exit $failed
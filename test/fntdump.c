@@ -0,0 +1,82 @@
+/*
+ * fntdump.c - print the header fields of a .fnt, and the table entry and
+ * pixels of some of its glyphs, as text for "make check" to compare with
+ * what it expects.
+ * Fields are read at their offsets in the file, so this does not depend
+ * on how the converter lays out its structures.
+ *
+ * Usage: fntdump file.fnt [code...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned char *fnt ;
+static long size ;
+
+static unsigned get(long off, int n)
+{
+  unsigned v = 0 ;
+
+  if ( off < 0 || off + n > size ) {
+    fprintf(stderr, "fntdump: field at %ld past the end\n", off) ;
+    exit(1) ;
+  }
+  while ( n-- )
+    v = v << 8 | fnt[off + n] ;
+  return v ;
+}
+
+int main(int argc, char *argv[])
+{
+  FILE *in ;
+  unsigned version, first, last, height, face, table, entry ;
+  long cap = 0 ;
+  int i ;
+
+  if ( argc < 2 || (in = fopen(argv[1], "rb")) == NULL ) {
+    fprintf(stderr, "Usage: fntdump file.fnt [code...]\n") ;
+    return 1 ;
+  }
+  do {
+    if ( size == cap && (fnt = (unsigned char *)realloc(fnt, cap = cap * 2 + 65536)) == NULL )
+      return 1 ;
+    size += fread(fnt + size, 1, cap - size, in) ;
+  } while ( ! feof(in) && ! ferror(in) ) ;
+  fclose(in) ;
+
+  version = get(0, 2) ;
+  first = get(95, 1) ;
+  last = get(96, 1) ;
+  height = get(88, 2) ;
+  face = get(105, 4) ;
+  table = version == 0x300 ? 148 : 118 ;
+  entry = version == 0x300 ? 6 : 4 ;
+  printf("version %x size %u face ", version, get(2, 4)) ;
+  for ( i = face ; i < size && fnt[i] ; i++ )
+    putchar(fnt[i]) ;
+  printf("\ncharset %u height %u ascent %u points %u weight %u italic %u\n",
+         get(85, 1), height, get(74, 2), get(68, 2), get(83, 2), get(80, 1)) ;
+  printf("pixwidth %u avgwidth %u maxwidth %u widthbytes %u\n",
+         get(86, 2), get(91, 2), get(93, 2), get(99, 2)) ;
+  printf("first %u last %u default %u break %u\n",
+         first, last, get(97, 1), get(98, 1)) ;
+
+  /* each glyph is its width in byte columns, each height bytes tall */
+  for ( i = 2 ; i < argc ; i++ ) {
+    unsigned c = atoi(argv[i]), width, off, x, y ;
+    if ( c < first || c > last ) {
+      printf("char %u missing\n", c) ;
+      continue ;
+    }
+    width = get(table + (c - first) * entry, 2) ;
+    off = get(table + (c - first) * entry + 2, entry - 2) ;
+    printf("char %u width %u offset %u\n", c, width, off) ;
+    for ( y = 0 ; y < height ; y++ ) {
+      for ( x = 0 ; x < width ; x++ )
+        putchar(get(off + x / 8 * height + y, 1) & (0x80 >> x % 8) ? '#' : '.') ;
+      putchar('\n') ;
+    }
+  }
+  return 0 ;
+}
@@ -0,0 +1,85 @@
+/*
+ * hexrow.c - check that the SIMD BITMAP row decoders in bdf2fon.c accept,
+ * reject and decode exactly what hexrow_scalar() does.  Rows of every
+ * length up to a few digits past the glyph width are tried, odd lengths
+ * included, each followed by one of several tails: line ends, blanks and
+ * junk after the row, invalid characters, and more digits than the width
+ * takes.  Each row is also placed at the very end of its buffer so the
+ * kernels have to stop at the limit.
+ *
+ * Usage: hexrow   (prints the cases that differ, exits 1 if any)
+ */
+
+#include "../bdf2fon.c"
+
+typedef int (*hexrowfn)(const char *, const char *, unsigned char *, int) ;
+
+static int failed ;
+
+static void compare(const char *name, hexrowfn fn, const char *row, int len,
+                    int tight, int ndigits)
+{
+  /* the buffer ends with the row's NUL when tight, else has slack after */
+  size_t size = len + 1 + (tight ? 0 : 64) ;
+  char *buf = (char *)calloc(size, 1) ;
+  unsigned char ref[64], out[64] ;
+  int rref, rout ;
+
+  if ( buf == NULL )
+    exit(2) ;
+  memcpy(buf, row, len) ;
+  memset(ref, 0x55, sizeof(ref)) ;
+  memset(out, 0x55, sizeof(out)) ;
+  rref = hexrow_scalar(buf, buf + size, ref, ndigits) ;
+  rout = fn(buf, buf + size, out, ndigits) ;
+  /* the output is unspecified when the row is rejected */
+  if ( rref != rout || (rref && memcmp(ref, out, ndigits / 2) != 0) ) {
+    printf("%s: %d digits, %s row \"%.*s\": %s\n", name, ndigits,
+           tight ? "tight" : "slack", len, row,
+           rref != rout ? "accept/reject differs" : "decoded bits differ") ;
+    failed = 1 ;
+  }
+  free(buf) ;
+}
+
+int main(int argc, char *argv[])
+{
+  static const char digits[] = "0123456789abcdefABCDEF" ;
+  static const char *tails[] = {
+    "", "\n", "\r\n", " \n", "\t", " junk\n", " 12\n", "0f0f\n",
+    "g\n", "-\n", "x", "\x80", "G",
+  } ;
+  static const struct { const char *name ; hexrowfn fn ; } kernels[] = {
+#ifdef HAVE_SIMD_HEXROW
+    { "sse2", hexrow_sse2 },
+    { "avx2", hexrow_avx2 },
+#endif
+    { NULL, NULL }
+  } ;
+  unsigned seed = 12345 ;
+  char row[128] ;
+  int k, ndigits, len, t, tight ;
+
+#ifdef HAVE_SIMD_HEXROW
+  __builtin_cpu_init() ;
+#endif
+  for ( k = 0 ; kernels[k].name ; k++ ) {
+#ifdef HAVE_SIMD_HEXROW
+    if ( kernels[k].fn == hexrow_avx2 && ! __builtin_cpu_supports("avx2") )
+      continue ;
+#endif
+    for ( ndigits = 2 ; ndigits <= 80 ; ndigits += 2 )
+      for ( len = 0 ; len <= ndigits + 3 ; len++ )
+        for ( t = 0 ; t < sizeof(tails) / sizeof(tails[0]) ; t++ ) {
+          int i, n = len ;
+          for ( i = 0 ; i < len ; i++ ) {
+            seed = seed * 1103515245 + 12345 ;
+            row[i] = digits[(seed >> 16) % (sizeof(digits) - 1)] ;
+          }
+          n += sprintf(row + n, "%s", tails[t]) ;
+          for ( tight = 0 ; tight < 2 ; tight++ )
+            compare(kernels[k].name, kernels[k].fn, row, n, tight, ndigits) ;
+        }
+  }
+  return failed ;
+}
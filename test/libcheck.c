@@ -0,0 +1,154 @@
+/*
+ * libcheck.c - use libbdf2fon the way an embedding program would, and
+ * check its buffer and error contracts: each BDF is parsed from a buffer
+ * holding exactly the file, with no NUL after it; its .fnt, and then the
+ * .fon of them all, are built both in library memory and in a caller
+ * buffer, which gives the same bytes when big enough and BDF2FON_ESPACE
+ * with the size needed when one byte short.  The .fon is written out for
+ * "make check" to compare with fnt2fon's.
+ *
+ * Usage: libcheck out.fon file.bdf...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../bdf2fon.h"
+
+static int failed ;
+
+static void fail(const char *what, const char *file, int err)
+{
+  printf("libcheck: %s: %s: %s\n", file, what, bdf2fon_strerror(err)) ;
+  failed = 1 ;
+}
+
+static char *readfile(const char *file, size_t *size)
+{
+  FILE *in = fopen(file, "rb") ;
+  char *data = NULL ;
+  long n = 0 ;
+
+  if ( in && fseek(in, 0, SEEK_END) == 0 && (n = ftell(in)) > 0 &&
+       fseek(in, 0, SEEK_SET) == 0 && (data = (char *)malloc(n)) != NULL &&
+       fread(data, 1, n, in) != (size_t)n ) {
+    free(data) ;
+    data = NULL ;
+  }
+  if ( in )
+    fclose(in) ;
+  *size = data ? n : 0 ;
+  return data ;
+}
+
+/* Build with encode() into library memory, then into caller buffers one
+   byte short and exactly big enough; returns the library's image */
+static unsigned char *build(int (*encode)(const void *, unsigned char **, size_t *),
+                            const void *arg, const char *what, const char *file,
+                            size_t *size)
+{
+  unsigned char *image = NULL, *buf ;
+  size_t need, room ;
+  int err ;
+
+  if ( (err = encode(arg, &image, size)) != BDF2FON_OK ) {
+    fail(what, file, err) ;
+    return NULL ;
+  }
+  need = *size ;
+  buf = (unsigned char *)malloc(need) ;
+  room = need - 1 ;
+  if ( (err = encode(arg, &buf, &room)) != BDF2FON_ESPACE || room != need )
+    fail("short caller buffer not refused", file, err) ;
+  memset(buf, 0x55, need) ;
+  room = need ;
+  if ( (err = encode(arg, &buf, &room)) != BDF2FON_OK || room != need ||
+       memcmp(buf, image, need) != 0 )
+    fail("caller buffer differs", file, err) ;
+  free(buf) ;
+  return image ;
+}
+
+static int encodefnt(const void *font, unsigned char **image, size_t *size)
+{
+  Bdf2fonOptions options = { 0, 0, 0, NULL } ;
+
+  return bdf2fon_fnt((const Bdf2fonFont *)font, &options, image, size) ;
+}
+
+typedef struct {
+  unsigned char **fnts ;
+  size_t *sizes ;
+  int n ;
+} Fnts ;
+
+static int encodefon(const void *arg, unsigned char **image, size_t *size)
+{
+  const Fnts *f = (const Fnts *)arg ;
+
+  return bdf2fon_fon((const unsigned char *const *)f->fnts, f->sizes, f->n, image, size) ;
+}
+
+int main(int argc, char *argv[])
+{
+  Fnts f ;
+  unsigned char *fon ;
+  size_t size ;
+  long line ;
+  FILE *out ;
+  int i, err ;
+
+  if ( argc < 3 ) {
+    fprintf(stderr, "Usage: libcheck out.fon file.bdf...\n") ;
+    return 2 ;
+  }
+  f.n = 0 ;
+  f.fnts = (unsigned char **)calloc(argc, sizeof(*f.fnts)) ;
+  f.sizes = (size_t *)calloc(argc, sizeof(*f.sizes)) ;
+  for ( i = 2 ; i < argc ; i++ ) {
+    Bdf2fonFont *font ;
+    char *bdf = readfile(argv[i], &size), *p ;
+
+    if ( bdf == NULL ) {
+      fail("can't read", argv[i], BDF2FON_OK) ;
+      continue ;
+    }
+    if ( (err = bdf2fon_parse(bdf, size, 0, NULL, &font, NULL)) != BDF2FON_OK ) {
+      fail("parse", argv[i], err) ;
+      free(bdf) ;
+      continue ;
+    }
+    if ( (f.fnts[f.n] = build(encodefnt, font, "fnt", argv[i], &f.sizes[f.n])) )
+      f.n++ ;
+    bdf2fon_free(font) ;
+
+    /* junk in the first BITMAP row: a parse error on that line */
+    for ( p = bdf ; p + 10 < bdf + size && memcmp(p, "BITMAP\n", 7) != 0 ; p++ ) ;
+    memcpy(p + 7, "xyz", 3) ;
+    line = 0 ;
+    err = bdf2fon_parse(bdf, size, 0, NULL, &font, &line) ;
+    if ( err != BDF2FON_EPARSE || line <= 0 )
+      fail("bad BITMAP row not reported", argv[i], err) ;
+    free(bdf) ;
+  }
+
+  if ( f.n && (fon = build(encodefon, &f, "fon", argv[1], &size)) != NULL ) {
+    if ( (out = fopen(argv[1], "wb")) == NULL ||
+         fwrite(fon, 1, size, out) != size || fclose(out) != 0 )
+      fail("can't write", argv[1], BDF2FON_OK) ;
+    bdf2fon_release(fon) ;
+  }
+
+  /* an image shorter than its dfSize is not a .fnt */
+  if ( f.n ) {
+    size_t cut = f.sizes[0] - 1 ;
+    fon = NULL ;
+    if ( (err = bdf2fon_fon((const unsigned char *const *)f.fnts, &cut, 1, &fon, &size)) != BDF2FON_EINVAL )
+      fail("truncated .fnt accepted", argv[2], err) ;
+  }
+  for ( i = 0 ; i < f.n ; i++ )
+    bdf2fon_release(f.fnts[i]) ;
+  free(f.fnts) ;
+  free(f.sizes) ;
+  return failed ;
+}